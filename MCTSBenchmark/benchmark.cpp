@@ -0,0 +1,991 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "flat_search_tree.hpp"
+#include "flat_search_tree_hash.hpp"
+#include "flat_search_ntree.hpp"
+#include "flat_search_ntree_uni.hpp"
+#if defined( _WIN32 )
+#    include "adjacency_search_tree.hpp" // The pool_allocator is VirtualAlloc based.
+#endif
+#include "tree_access.hpp"
+#include "compressed_search_tree.hpp"
+#include "relayout.hpp"
+#include "traversal.hpp"
+#include "parallel_traversal.hpp"
+#include "prune.hpp"
+#include "child_blocks.hpp"
+#include "widening.hpp"
+#include "huge_page_allocator.hpp"
+#include "numa.hpp"
+#include "batched_rng.hpp"
+#include "mcts_emu.hpp"
+#include "workload.hpp"
+#include "benchmark.hpp"
+#include "perf_counters.hpp"
+
+template<typename Tree>
+[[nodiscard]] std::uint64_t nodeCount ( Tree const & tree_ ) noexcept {
+    if constexpr ( tree_access::has_arcs<Tree> )
+        return static_cast<std::uint64_t> ( tree_.nodeNum ( ) );
+    else
+        return static_cast<std::uint64_t> ( tree_.size ( ) );
+}
+
+// The memory held by the tree, reserved but unused capacity included.
+template<typename Tree>
+[[nodiscard]] std::size_t treeBytes ( Tree const & tree_ ) noexcept {
+    if constexpr ( std::is_pointer<typename Tree::NodeID>::value ) { // ast, pool allocated, plus the in- and out-lists.
+        return tree_.nodeNum ( ) * sizeof ( typename Tree::Node ) +
+               tree_.arcNum ( ) * ( sizeof ( typename Tree::Arc ) + 2 * sizeof ( typename Tree::ArcID ) );
+    }
+    else {
+        auto const & nodes = tree_access::nodes ( tree_ );
+        std::size_t bytes  = nodes.capacity ( ) * sizeof ( typename std::decay_t<decltype ( nodes )>::value_type );
+        if constexpr ( tree_access::has_arcs<Tree> ) {
+            auto const & arcs = tree_access::arcs ( tree_ );
+            bytes += arcs.capacity ( ) * sizeof ( typename std::decay_t<decltype ( arcs )>::value_type );
+        }
+        if constexpr ( tree_access::has_transpositions<Tree> ) { // One control byte per slot.
+            auto const & trans = tree_access::transpositions ( tree_ );
+            bytes += trans.bucket_count ( ) * ( sizeof ( typename Tree::Trans::value_type ) + 1 );
+        }
+        return bytes;
+    }
+}
+
+template<typename Tree, typename = void>
+struct has_make_sub_tree : std::false_type {};
+template<typename Tree>
+struct has_make_sub_tree<Tree, std::void_t<decltype ( std::declval<Tree &> ( ).makeSubTree ( typename Tree::NodeID{ } ) )>>
+    : std::true_type {};
+
+template<typename Tree, typename = void>
+struct has_root : std::false_type {};
+template<typename Tree>
+struct has_root<Tree, std::void_t<decltype ( std::declval<Tree &> ( ).root ( typename Tree::NodeID{ } ) )>> : std::true_type {};
+
+// Makes node_ the root, as after a move is played, fst and fsth copy the sub-tree, fsntu re-roots in place.
+template<typename Tree>
+void reroot ( Tree & tree_, const typename Tree::NodeID node_ ) {
+    if constexpr ( has_make_sub_tree<Tree>::value )
+        tree_ = tree_.makeSubTree ( node_ );
+    else if constexpr ( has_root<Tree>::value )
+        tree_.root ( node_ );
+}
+
+// The select/expand emulation of main.cpp: descend from the root with probability 0.66 per level, then expand with
+// probability 0.33, until the tree holds nodes_ nodes. One op is one such playout. With counters enabled, the tree is
+// serialized and re-rooted afterwards as well, where the tree supports it.
+template<typename Tree, typename Rng>
+void playout ( bench::Phases & phases_, Tree & tree_, Rng & rng_, const Int moves_ ) {
+    std::bernoulli_distribution descend ( 0.66 ), expand ( 0.33 );
+    typename Tree::NodeID node = tree_.root_node;
+    {
+        bench::ScopedPhase phase ( phases_, bench::Phase::select );
+        while ( descend ( rng_ ) and hasChild ( tree_, node ) )
+            node = selectChild ( tree_, node, rng_ );
+    }
+    if ( expand ( rng_ ) and hasMoves ( tree_, node ) ) {
+        bench::ScopedPhase phase ( phases_, bench::Phase::expand );
+        addChild ( tree_, node, rng_, moves_ );
+    }
+}
+
+template<typename Tree>
+[[nodiscard]] bench::Measure emulate ( bench::Phases & phases_, const std::uint64_t seed_, const std::uint64_t nodes_,
+                                       const Int moves_ ) {
+    ext::buffered_rng rng = ext::rng_stream ( seed_, 0u );
+    Tree tree ( getMoves ( rng, moves_ ) );
+    bench::Measure measure;
+    while ( nodeCount ( tree ) < nodes_ ) {
+        playout ( phases_, tree, rng, moves_ );
+        ++measure.ops;
+    }
+    measure.nodes = nodeCount ( tree );
+    measure.bytes = treeBytes ( tree );
+    if constexpr ( not std::is_pointer<typename Tree::NodeID>::value ) { // Not ast.
+        if ( phases_.enabled ( ) ) {
+            {
+                std::ostringstream out;
+                bench::ScopedPhase phase ( phases_, bench::Phase::serialize );
+                cst::save ( tree, out );
+            }
+            if constexpr ( has_make_sub_tree<Tree>::value or has_root<Tree>::value ) {
+                const typename Tree::NodeID child = selectChild ( tree, tree.root_node, rng );
+                bench::ScopedPhase phase ( phases_, bench::Phase::reroot );
+                reroot ( tree, child );
+            }
+        }
+    }
+    return measure;
+}
+
+// Every tree runs the same cases with the same seeds, the rows are comparable across trees and across runs. Trees with
+// narrow ids run the cases up to max_nodes_ only.
+template<typename Tree>
+void addCases ( bench::Runner & runner_, char const * tree_name_, const std::uint64_t max_nodes_ = 1u << 20 ) {
+    for ( const std::uint64_t nodes : { 1u << 14, 1u << 17, 1u << 20 } ) {
+        if ( nodes > max_nodes_ )
+            continue;
+        for ( const Int moves : { 8, 32, 64 } ) {
+            const std::uint64_t seed = 0x5EED'0000'0000'0000 ^ ( nodes << 8 ) ^ static_cast<std::uint64_t> ( moves );
+            runner_.add ( std::string ( tree_name_ ) + "/nodes:" + std::to_string ( nodes ) + "/moves:" + std::to_string ( moves ),
+                          [ = ] ( bench::Phases & phases_ ) { return emulate<Tree> ( phases_, seed, nodes, moves ); } );
+        }
+    }
+}
+
+// A search shaped like a production search (PUCT focus, progressive widening, variable branching), see workload.hpp,
+// fsth with 5% transpositions.
+template<typename Tree>
+void addWorkloadCases ( bench::Runner & runner_, char const * tree_name_ ) {
+    for ( const std::uint64_t nodes : { 1u << 17, 1u << 20 } ) {
+        WorkloadConfig config;
+        if constexpr ( tree_access::has_transpositions<Tree> )
+            config.transposition_rate = 0.05;
+        runner_.add ( std::string ( tree_name_ ) + "/workload:puct/nodes:" + std::to_string ( nodes ), [ = ] ( bench::Phases & ) {
+            WorkloadGenerator generator ( config );
+            Tree tree = generator.makeTree<Tree> ( );
+            bench::Measure measure;
+            measure.ops   = generator.grow ( tree, nodes );
+            measure.nodes = nodeCount ( tree );
+            measure.bytes = treeBytes ( tree );
+            return measure;
+        } );
+    }
+}
+
+// Probes of a finished search, as when a tree is kept for analysis or book probing: descents from the root, following a
+// recorded sequence of moves, matching the move against the out-arcs at each level. The descents are drawn in proportion
+// to the visit counts, so they repeat the hot lines of the search. One op is one descent, only the descents are timed,
+// on the tree as grown (order:expansion) and after lyt::relayout, keyed by the visit counts.
+template<typename Tree>
+void addProbeCases ( bench::Runner & runner_, char const * tree_name_ ) {
+    constexpr std::size_t probes = 1u << 18;
+    constexpr char const * order_names[] = { "expansion", "veb", "hot" };
+    for ( const std::uint64_t nodes : { 1u << 17, 1u << 20 } ) {
+        for ( int order = 0; order < 3; ++order ) {
+            std::string const name =
+                std::string ( tree_name_ ) + "/probe/order:" + order_names[ order ] + "/nodes:" + std::to_string ( nodes );
+            runner_.add ( name, [ = ] ( bench::Phases & ) {
+                using NodeID = typename Tree::NodeID;
+                WorkloadConfig config;
+                if constexpr ( tree_access::has_transpositions<Tree> )
+                    config.transposition_rate = 0.05;
+                WorkloadGenerator generator ( config );
+                Tree tree = generator.makeTree<Tree> ( );
+                generator.grow ( tree, nodes );
+                // The lines, as the number of moves followed by the moves.
+                std::vector<std::uint8_t> lines;
+                ext::buffered_rng rng{ config.seed };
+                for ( std::size_t p = 0; p < probes; ++p ) {
+                    std::size_t const length = lines.size ( );
+                    lines.push_back ( 0 );
+                    for ( NodeID node = tree.root_node; tree.hasOutArc ( node ); ++lines[ length ] ) {
+                        std::uint32_t pick = rng.bounded ( std::max ( generator.visitCount ( node ), 1u ) );
+                        auto arc           = tree.cbeginOut ( node ).id ( );
+                        for ( auto it = tree.cbeginOut ( node ); it.is_valid ( ); ++it ) {
+                            arc = it.id ( );
+                            if ( pick < generator.visitCount ( it->target ) )
+                                break;
+                            pick -= generator.visitCount ( it->target );
+                        }
+                        lines.push_back ( tree[ arc ].value );
+                        node = tree.link ( arc ).target;
+                    }
+                }
+                if ( order )
+                    tree = lyt::relayout ( tree, 1 == order ? lyt::Order::van_emde_boas : lyt::Order::hot_path_first,
+                                           [ &generator ] ( NodeID const node_ ) { return generator.visitCount ( node_ ); } );
+                bench::Measure measure;
+                std::uint64_t found = 0;
+                plf::nanotimer timer;
+                timer.start ( );
+                for ( std::uint8_t const *line = lines.data ( ), *const last = line + lines.size ( ); line != last; ) {
+                    NodeID node                    = tree.root_node;
+                    std::uint8_t const * const end = line + 1 + *line;
+                    for ( ++line; line != end; ++line ) {
+                        auto it = tree.cbeginOut ( node );
+                        while ( tree[ it.id ( ) ].value != *line )
+                            ++it;
+                        node = it->target;
+                    }
+                    found += node.value;
+                }
+                measure.ns    = timer.get_elapsed_ns ( );
+                bench::keep ( found );
+                measure.ops   = probes;
+                measure.nodes = nodeCount ( tree );
+                measure.bytes = treeBytes ( tree );
+                return measure;
+            } );
+        }
+    }
+}
+
+// Expansion of all moves of a leaf at once, as a policy that evaluates all children of a leaf does: descend uniformly at
+// random to a leaf and expand it, until the tree holds nodes_ nodes. One: a child at a time (addChild), bulk: all
+// children in one step (addChildren, add_children). One op is one expanded leaf.
+template<typename Tree>
+void addExpansionCases ( bench::Runner & runner_, char const * tree_name_ ) {
+    constexpr Int moves = 32;
+    for ( const std::uint64_t nodes : { 1u << 17, 1u << 20 } ) {
+        for ( const bool bulk : { false, true } ) {
+            std::string const name =
+                std::string ( tree_name_ ) + "/expand:" + ( bulk ? "bulk" : "one" ) + "/nodes:" + std::to_string ( nodes );
+            runner_.add ( name, [ = ] ( bench::Phases & phases_ ) {
+                    ext::buffered_rng rng = ext::rng_stream ( 0x5EED'0000'0000'0043 ^ nodes, 0u );
+                    Tree tree ( getMoves ( rng, moves ) );
+                    bench::Measure measure;
+                    while ( nodeCount ( tree ) < nodes ) {
+                        typename Tree::NodeID node = tree.root_node;
+                        {
+                            bench::ScopedPhase phase ( phases_, bench::Phase::select );
+                            while ( hasChild ( tree, node ) )
+                                node = selectChild ( tree, node, rng );
+                        }
+                        bench::ScopedPhase phase ( phases_, bench::Phase::expand );
+                        if ( bulk )
+                            addChildren ( tree, node, rng, moves );
+                        else
+                            while ( hasMoves ( tree, node ) )
+                                addChild ( tree, node, rng, moves );
+                        ++measure.ops;
+                    }
+                    measure.nodes = nodeCount ( tree );
+                    measure.bytes = treeBytes ( tree );
+                    return measure;
+            } );
+        }
+    }
+}
+
+// Progressive widening, k = 1 and alpha = 0.5, on a game with 64 moves: descend, scanning the data of the active
+// children of every node on the way (as a UCB selection does) and picking one uniformly at random, until a node widens.
+// One: the new child is added then (addChild), slab: the children come in doubling slabs (pw::Widener), the widening
+// activates the next one. One op is one playout, nodes are all nodes, active or not.
+template<typename Tree>
+void addWideningCases ( bench::Runner & runner_, char const * tree_name_ ) {
+    constexpr Int moves = 64;
+    for ( const std::uint64_t playouts : { 1u << 17, 1u << 20 } ) {
+        for ( const bool slab : { false, true } ) {
+            std::string const name =
+                std::string ( tree_name_ ) + "/widen:" + ( slab ? "slab" : "one" ) + "/playouts:" + std::to_string ( playouts );
+            runner_.add ( name, [ = ] ( bench::Phases & phases_ ) {
+                using NodeID          = typename Tree::NodeID;
+                ext::buffered_rng rng = ext::rng_stream ( 0x5EED'0000'0000'0044 ^ playouts, 0u );
+                Tree tree ( getMoves ( rng, moves ) );
+                pw::Widener<Tree> widener;
+                std::vector<std::uint32_t> visits;
+                std::vector<NodeID> active;
+                std::uint64_t sum = 0;
+                for ( std::uint64_t p = 0; p < playouts; ++p ) {
+                    NodeID node = tree.root_node;
+                    while ( true ) {
+                        if ( static_cast<std::size_t> ( node.value ) >= visits.size ( ) )
+                            visits.resize ( 2 * static_cast<std::size_t> ( node.value ) + 1, 0u );
+                        std::uint32_t const v = ++visits[ node.value ];
+                        std::size_t const remaining = static_cast<std::size_t> ( tree[ node ].size ( ) );
+                        bool widened = false;
+                        {
+                            bench::ScopedPhase phase ( phases_, bench::Phase::expand );
+                            if ( slab ) {
+                                std::size_t const before = widener.active ( node );
+                                widened =
+                                    widener.widen ( tree, node, v, remaining, childGenerator ( tree, node, rng, moves ) ) > before;
+                            }
+                            else if ( remaining and childNum ( tree, node ) < widener.schedule ( ).allowed ( v ) ) {
+                                addChild ( tree, node, rng, moves );
+                                widened = true;
+                            }
+                        }
+                        if ( widened )
+                            break;
+                        bench::ScopedPhase phase ( phases_, bench::Phase::select );
+                        active.clear ( );
+                        auto const scan = [ & ] ( NodeID const child_ ) {
+                            sum += tree[ child_ ].size ( );
+                            active.push_back ( child_ );
+                        };
+                        if ( slab )
+                            widener.forEachActive ( tree, node, scan );
+                        else if constexpr ( tree_access::has_arcs<Tree> )
+                            for ( auto it = tree.cbeginOut ( node ); it.is_valid ( ); ++it )
+                                scan ( it->target );
+                        else
+                            for ( typename Tree::const_out_iterator it{ tree, node }; it.is_valid ( ); ++it )
+                                scan ( it.id ( ) );
+                        if ( active.empty ( ) )
+                            break;
+                        node = active[ rng.bounded ( static_cast<std::uint32_t> ( active.size ( ) ) ) ];
+                    }
+                }
+                bench::keep ( sum );
+                bench::Measure measure;
+                measure.ops   = playouts;
+                measure.nodes = nodeCount ( tree );
+                measure.bytes = treeBytes ( tree );
+                return measure;
+            } );
+        }
+    }
+}
+
+// The node data of the backup cases, the moves plus the statistics of a node.
+struct StatsType : MovesType {
+    std::uint32_t visits = 0;
+    float score          = 0.0f;
+};
+
+// Backup from a leaf to the root, on a tree grown by the workload generator (in the order of expansion, the ancestors of
+// a node are spread out over the vector), as a search that evaluates its leaves in batches does: descend uniformly at
+// random to batch_ leaves, then update the visits and the score (negamax) of the nodes on the way back from each leaf.
+// Path: the descents keep their nodes (Path takes arcs, these trees have none) and the backups walk them backwards, up:
+// the descents keep the leaf only and the backups climb the up-links (backpropagate), with a prefetch of the parent.
+// One op is one playout, the descents are timed as well, they are the same for both.
+template<typename Tree>
+void addBackupCases ( bench::Runner & runner_, char const * tree_name_ ) {
+    constexpr std::size_t playouts = 1u << 18;
+    for ( const std::uint64_t nodes : { 1u << 17, 1u << 20 } ) {
+        for ( const std::size_t batch : { 1u, 256u } ) {
+            for ( const bool up : { false, true } ) {
+                std::string const name = std::string ( tree_name_ ) + "/backup:" + ( up ? "up" : "path" ) +
+                                         "/batch:" + std::to_string ( batch ) + "/nodes:" + std::to_string ( nodes );
+                runner_.add ( name, [ = ] ( bench::Phases & ) {
+                    using NodeID = typename Tree::NodeID;
+                    WorkloadGenerator generator;
+                    Tree tree = generator.makeTree<Tree> ( );
+                    generator.grow ( tree, nodes );
+                    auto const update = [] ( StatsType & stats_, float const value_ ) noexcept {
+                        ++stats_.visits;
+                        stats_.score += value_;
+                        return -value_;
+                    };
+                    ext::buffered_rng rng{ 0x5EED'0000'0000'0045 ^ nodes };
+                    std::vector<NodeID> paths;        // The nodes of the descents of a batch, root first, or the leaves (up).
+                    std::vector<std::size_t> lengths; // Path only, the length of each descent.
+                    paths.reserve ( 64u * batch );
+                    lengths.reserve ( batch );
+                    bench::Measure measure;
+                    plf::nanotimer timer;
+                    timer.start ( );
+                    for ( std::size_t p = 0; p < playouts; p += batch ) {
+                        paths.clear ( );
+                        lengths.clear ( );
+                        for ( std::size_t b = 0; b < batch; ++b ) {
+                            NodeID node              = tree.root_node;
+                            std::size_t const length = paths.size ( );
+                            if ( not up )
+                                paths.push_back ( node );
+                            while ( hasChild ( tree, node ) ) {
+                                node = selectChild ( tree, node, rng );
+                                if ( not up )
+                                    paths.push_back ( node );
+                            }
+                            if ( up )
+                                paths.push_back ( node );
+                            else
+                                lengths.push_back ( paths.size ( ) - length );
+                        }
+                        if ( up ) {
+                            for ( NodeID const leaf : paths )
+                                tree.backpropagate ( leaf, 1.0f, update );
+                        }
+                        else {
+                            std::size_t first = 0;
+                            for ( std::size_t const length : lengths ) {
+                                float value = 1.0f;
+                                for ( std::size_t i = first + length; i-- > first; )
+                                    value = update ( tree[ paths[ i ] ], value );
+                                first += length;
+                            }
+                        }
+                    }
+                    measure.ns = timer.get_elapsed_ns ( );
+                    bench::keep ( tree[ tree.root_node ].visits );
+                    measure.ops   = playouts;
+                    measure.nodes = nodeCount ( tree );
+                    measure.bytes = treeBytes ( tree );
+                    return measure;
+                } );
+            }
+        }
+    }
+}
+
+// The backups of the DAG of fsth, on a tree grown by the workload generator with a transposition rate of trans_ (the
+// share of the expansions that link to a node of the same depth): descend uniformly at random to a leaf, recording the
+// path, then update the visits and the score of the nodes on the way back. Path: along the path, all: all ancestors of
+// the leaf once (fsth::SearchTree::BackupScratch, the marks reset in O ( 1 )), clear: the same, with a vector<bool> of
+// marks cleared per backup, as the traversals do. One op is one playout, the descents are timed as well.
+void addDagBackupCases ( bench::Runner & runner_ ) {
+    using Tree                     = fsth::SearchTree<MoveType, StatsType>;
+    constexpr std::size_t playouts = 1u << 18;
+    constexpr char const * mode_names[] = { "path", "all", "clear" };
+    for ( const std::uint64_t nodes : { 1u << 17, 1u << 20 } ) {
+        for ( const double trans : { 0.0, 0.05, 0.25 } ) {
+            for ( int mode = 0; mode < 3; ++mode ) {
+                std::ostringstream name;
+                name << "fsth/dag:" << mode_names[ mode ] << "/trans:" << trans << "/nodes:" << nodes;
+                runner_.add ( name.str ( ), [ = ] ( bench::Phases & ) {
+                    using NodeID = Tree::NodeID;
+                    using ArcID  = Tree::ArcID;
+                    WorkloadConfig config;
+                    config.transposition_rate = trans;
+                    WorkloadGenerator generator ( config );
+                    Tree tree = generator.makeTree<Tree> ( );
+                    generator.grow ( tree, nodes );
+                    auto const update = [] ( StatsType & stats_, float const value_ ) noexcept {
+                        ++stats_.visits;
+                        stats_.score += value_;
+                        return -value_;
+                    };
+                    auto const & tree_arcs  = tree_access::arcs ( tree );
+                    auto const & tree_nodes = tree_access::nodes ( tree );
+                    ext::buffered_rng rng{ 0x5EED'0000'0000'0046 ^ nodes };
+                    Tree::Path path;
+                    Tree::BackupScratch<float> scratch;
+                    std::vector<bool> seen;
+                    std::vector<std::pair<NodeID, float>> queue;
+                    bench::Measure measure;
+                    plf::nanotimer timer;
+                    timer.start ( );
+                    for ( std::size_t p = 0; p < playouts; ++p ) {
+                        NodeID node = tree.root_node;
+                        path.reset ( tree.root_arc, node );
+                        while ( tree.hasOutArc ( node ) ) {
+                            auto it = tree.cbeginOut ( node );
+                            std::advance ( it, rng.bounded ( static_cast<std::uint32_t> ( tree.outArcNum ( node ) ) ) );
+                            path.push ( it.id ( ), node = it->target );
+                        }
+                        if ( 0 == mode ) {
+                            tree.backpropagate ( path, 1.0f, update );
+                        }
+                        else if ( 1 == mode ) {
+                            tree.backpropagate ( node, 1.0f, update, scratch );
+                        }
+                        else {
+                            seen.clear ( );
+                            seen.resize ( tree_nodes.size ( ), false );
+                            queue.clear ( );
+                            seen[ node.value ] = true;
+                            queue.emplace_back ( node, 1.0f );
+                            for ( std::size_t i = 0; i < queue.size ( ); ++i ) {
+                                float const value = update ( tree[ queue[ i ].first ], queue[ i ].second );
+                                for ( ArcID in = tree_nodes[ queue[ i ].first.value ].head_in; ArcID::invalid ( ) != in;
+                                      in       = tree_arcs[ in.value ].next_in ) {
+                                    NodeID const parent = tree_arcs[ in.value ].source;
+                                    if ( NodeID::invalid ( ) != parent and not seen[ parent.value ] ) {
+                                        seen[ parent.value ] = true;
+                                        queue.emplace_back ( parent, value );
+                                    }
+                                }
+                            }
+                        }
+                    }
+                    measure.ns = timer.get_elapsed_ns ( );
+                    bench::keep ( tree[ tree.root_node ].visits );
+                    measure.ops   = playouts;
+                    measure.nodes = nodeCount ( tree );
+                    measure.bytes = treeBytes ( tree );
+                    return measure;
+                } );
+            }
+        }
+    }
+}
+
+// Walks of the sub-trees of random nodes (most are small), breadth first, counting the nodes (trv::Visitor), on a tree
+// grown by the workload generator. Fresh: every walk gets a new trv::Scratch (the marks are sized to the tree, as the
+// traversals with their vector<bool> of marks did), reused: all walks share one, the marks are reset in O ( 1 ). One op
+// is one walk.
+template<typename Tree>
+void addWalkCases ( bench::Runner & runner_, char const * tree_name_ ) {
+    constexpr std::size_t walks = 1u << 16;
+    for ( const std::uint64_t nodes : { 1u << 17, 1u << 20 } ) {
+        for ( const bool reused : { false, true } ) {
+            std::string const name = std::string ( tree_name_ ) + "/walk:" + ( reused ? "reused" : "fresh" ) +
+                                     "/nodes:" + std::to_string ( nodes );
+            runner_.add ( name, [ = ] ( bench::Phases & ) {
+                using NodeID = typename Tree::NodeID;
+                struct Count : trv::Visitor {
+                    std::uint64_t nodes = 0;
+                    trv::Visit pre ( NodeID const ) noexcept {
+                        ++nodes;
+                        return trv::Visit::proceed;
+                    }
+                };
+                WorkloadConfig config;
+                if constexpr ( tree_access::has_transpositions<Tree> )
+                    config.transposition_rate = 0.05;
+                WorkloadGenerator generator ( config );
+                Tree tree = generator.makeTree<Tree> ( );
+                generator.grow ( tree, nodes );
+                ext::buffered_rng rng{ 0x5EED'0000'0000'0047 ^ nodes };
+                Count count;
+                trv::Scratch<Tree> scratch;
+                bench::Measure measure;
+                plf::nanotimer timer;
+                timer.start ( );
+                for ( std::size_t w = 0; w < walks; ++w ) {
+                    NodeID const root{ 1u + rng.bounded ( static_cast<std::uint32_t> ( nodeCount ( tree ) ) ) };
+                    if ( reused )
+                        tree.traverseBreadthFirst ( root, count, scratch );
+                    else
+                        tree.traverseBreadthFirst ( root, count );
+                }
+                measure.ns = timer.get_elapsed_ns ( );
+                bench::keep ( count.nodes );
+                measure.ops   = walks;
+                measure.nodes = nodeCount ( tree );
+                measure.bytes = treeBytes ( tree );
+                return measure;
+            } );
+        }
+    }
+}
+
+// Topological sort of an fsth DAG, grown by the workload generator with a transposition rate of trans_. Rescan: Kahn as
+// fst and fsth had it, the in-arcs of a target are rescanned for every arc taken (O ( sum of the in-degrees squared )),
+// kahn: trv::topologicalSort, the in-arcs are counted down (O ( nodes + arcs )), with its layers, the scratch and the
+// output are reused. One op is one node sorted.
+void addTopologicalSortCases ( bench::Runner & runner_ ) {
+    using Tree                 = fsth::SearchTree<MoveType, MovesType>;
+    constexpr std::size_t sorts = 8;
+    for ( const std::uint64_t nodes : { 1u << 17, 1u << 20 } ) {
+        for ( const double trans : { 0.0, 0.25, 0.5 } ) {
+            for ( const bool kahn : { false, true } ) {
+                std::ostringstream name;
+                name << "fsth/topo:" << ( kahn ? "kahn" : "rescan" ) << "/trans:" << trans << "/nodes:" << nodes;
+                runner_.add ( name.str ( ), [ = ] ( bench::Phases & ) {
+                    using NodeID = Tree::NodeID;
+                    using ArcID  = Tree::ArcID;
+                    WorkloadConfig config;
+                    config.transposition_rate = trans;
+                    WorkloadGenerator generator ( config );
+                    Tree tree = generator.makeTree<Tree> ( );
+                    generator.grow ( tree, nodes );
+                    auto const & tree_arcs  = tree_access::arcs ( tree );
+                    auto const & tree_nodes = tree_access::nodes ( tree );
+                    std::vector<NodeID> sorted;
+                    std::vector<std::size_t> layers;
+                    trv::Scratch<Tree> scratch;
+                    std::vector<bool> removed_arcs;
+                    std::vector<NodeID> stack;
+                    bench::Measure measure;
+                    plf::nanotimer timer;
+                    timer.start ( );
+                    for ( std::size_t s = 0; s < sorts; ++s ) {
+                        sorted.clear ( );
+                        if ( kahn ) {
+                            layers.clear ( );
+                            trv::topologicalSort ( tree, tree.root_node, sorted, &layers, scratch );
+                            continue;
+                        }
+                        removed_arcs.assign ( tree_arcs.size ( ), false );
+                        stack.assign ( 1u, tree.root_node );
+                        while ( stack.size ( ) ) {
+                            sorted.push_back ( stack.back ( ) );
+                            stack.pop_back ( );
+                            for ( ArcID out = tree_nodes[ sorted.back ( ).value ].head_out; ArcID::invalid ( ) != out;
+                                  out       = tree_arcs[ out.value ].next_out ) {
+                                removed_arcs[ out.value ] = true;
+                                bool has_no_in_arcs       = true;
+                                for ( ArcID in = tree_nodes[ tree_arcs[ out.value ].target.value ].head_in;
+                                      ArcID::invalid ( ) != in; in = tree_arcs[ in.value ].next_in )
+                                    if ( not removed_arcs[ in.value ] ) {
+                                        has_no_in_arcs = false;
+                                        break;
+                                    }
+                                if ( has_no_in_arcs )
+                                    stack.push_back ( tree_arcs[ out.value ].target );
+                            }
+                        }
+                    }
+                    measure.ns = timer.get_elapsed_ns ( );
+                    bench::keep ( sorted.back ( ).value );
+                    measure.ops   = sorts * sorted.size ( );
+                    measure.nodes = nodeCount ( tree );
+                    measure.bytes = treeBytes ( tree );
+                    return measure;
+                } );
+            }
+        }
+    }
+}
+
+// Breadth first traversal and sub-tree copy of the whole tree (the sub-tree from the first child of the root), seq: the
+// single-threaded traverseBreadthFirst and makeSubTree, par: ptrv::breadthFirst and ptrv::makeSubTree on a pool of 1 and
+// of all hardware threads. The pool and the scratch are made up front, a sub-tree copy is timed on a fresh tree (it
+// moves the nodes out). One op is one node visited (copied).
+template<typename Tree>
+void addParallelCases ( bench::Runner & runner_, char const * tree_name_ ) {
+    std::vector<std::size_t> pools{ 0, 1 }; // 0 is sequential.
+    if ( std::thread::hardware_concurrency ( ) > 1 )
+        pools.push_back ( std::thread::hardware_concurrency ( ) );
+    for ( const std::uint64_t nodes : { 1u << 20, 1u << 23 } ) {
+        for ( const bool copy : { false, true } ) {
+            for ( const std::size_t threads : pools ) {
+                std::string const name = std::string ( tree_name_ ) + ( copy ? "/subtree:" : "/bfs:" ) +
+                                         ( threads ? "par" : "seq" ) + "/threads:" +
+                                         std::to_string ( std::max ( threads, std::size_t{ 1 } ) ) +
+                                         "/nodes:" + std::to_string ( nodes );
+                runner_.add ( name, [ = ] ( bench::Phases & ) {
+                    using NodeID = typename Tree::NodeID;
+                    WorkloadConfig config;
+                    if constexpr ( tree_access::has_transpositions<Tree> )
+                        config.transposition_rate = 0.05;
+                    WorkloadGenerator generator ( config );
+                    Tree tree = generator.makeTree<Tree> ( );
+                    generator.grow ( tree, nodes );
+                    ptrv::Pool pool ( std::max ( threads, std::size_t{ 1 } ) );
+                    ptrv::Scratch<Tree> scratch;
+                    trv::Scratch<Tree> sequential;
+                    std::vector<NodeID> order;
+                    std::vector<std::size_t> levels;
+                    bench::Measure measure;
+                    measure.nodes = nodeCount ( tree );
+                    measure.bytes = treeBytes ( tree );
+                    plf::nanotimer timer;
+                    if ( copy ) {
+                        NodeID const root{ 2 };
+                        timer.start ( );
+                        Tree sub_tree = threads ? ptrv::makeSubTree ( tree, root, pool, scratch ) : tree.makeSubTree ( root );
+                        measure.ns  = timer.get_elapsed_ns ( );
+                        measure.ops = nodeCount ( sub_tree );
+                    }
+                    else {
+                        struct Count : trv::Visitor {
+                            std::uint64_t nodes = 0;
+                            trv::Visit pre ( NodeID const ) noexcept {
+                                ++nodes;
+                                return trv::Visit::proceed;
+                            }
+                        };
+                        Count count;
+                        timer.start ( );
+                        if ( threads )
+                            ptrv::breadthFirst ( tree, tree.root_node, pool, scratch, order, levels );
+                        else
+                            tree.traverseBreadthFirst ( tree.root_node, count, sequential );
+                        measure.ns  = timer.get_elapsed_ns ( );
+                        measure.ops = threads ? order.size ( ) : count.nodes;
+                    }
+                    return measure;
+                } );
+            }
+        }
+    }
+}
+
+// Pruning (gc::prune) by the visit counts of the workload generator. Once: a tree of nodes is pruned to half its bytes.
+// Ceiling: the search goes on under a ceiling of the bytes of a tree of nodes, when it is reached the tree is pruned to
+// three quarters of it and the generator follows the remap, for 8 rounds. The ns are the pauses, one op is one node
+// pruned.
+template<typename Tree>
+void addPruneCases ( bench::Runner & runner_, char const * tree_name_ ) {
+    constexpr std::size_t rounds = 8;
+    for ( const std::uint64_t nodes : { 1u << 17, 1u << 20 } ) {
+        for ( const bool ceiling : { false, true } ) {
+            std::string const name =
+                std::string ( tree_name_ ) + "/prune:" + ( ceiling ? "ceiling" : "once" ) + "/nodes:" + std::to_string ( nodes );
+            runner_.add ( name, [ = ] ( bench::Phases & ) {
+                using NodeID = typename Tree::NodeID;
+                WorkloadGenerator generator;
+                Tree tree = generator.makeTree<Tree> ( );
+                generator.grow ( tree, nodes );
+                std::size_t const bytes = gc::usedBytes ( tree );
+                auto const score        = [ &generator ] ( NodeID const node_ ) noexcept { return generator.visitCount ( node_ ); };
+                std::vector<NodeID> remap;
+                bench::Measure measure;
+                for ( std::size_t r = 0; r < ( ceiling ? rounds : 1u ); ++r ) {
+                    if ( r )
+                        generator.grow ( tree, nodes );
+                    gc::PruneStats const stats = gc::prune ( tree, ceiling ? bytes / 4 * 3 : bytes / 2, score, &remap );
+                    generator.remap ( remap );
+                    measure.ns += stats.pause_ns ( );
+                    measure.ops += stats.nodes_before - stats.nodes_after;
+                }
+                measure.nodes = nodeCount ( tree );
+                measure.bytes = treeBytes ( tree );
+                return measure;
+            } );
+        }
+    }
+}
+
+// Child lists of wide nodes, the out-lists of the tree against cbl::ChildBlocks. The root gets children / arity children
+// (the parents), the parents get arity children each, appended round-robin, so the siblings are spread out over the
+// vectors as in a tree that grows by playouts. Append: one op is one child, the tree is built, plus the blocks for the
+// blocks, which are kept next to the tree. Iterate: one op is one child, reading its data (the move of the arc in fst,
+// the moves of the node in fsnt), the parents in order, only the iteration is timed.
+template<typename Tree>
+void addChildListCases ( bench::Runner & runner_, char const * tree_name_ ) {
+    using Blocks                      = cbl::ChildBlocksOf<Tree>;
+    constexpr std::uint64_t children  = 1u << 18;
+    constexpr int passes              = 4;
+    constexpr char const * list_names[] = { "list", "blocks" };
+    auto const build = [] ( Tree & tree_, Blocks * blocks_, std::uint64_t const parents_, std::uint64_t const arity_ ) {
+        using NodeID = typename Tree::NodeID;
+        std::vector<NodeID> parents;
+        parents.reserve ( parents_ );
+        for ( std::uint64_t p = 0; p < parents_; ++p ) {
+            if constexpr ( tree_access::has_arcs<Tree> )
+                tree_.addArc ( tree_.root_node, parents.emplace_back ( tree_.addNode ( ) ), MoveType{ } );
+            else
+                parents.push_back ( tree_.add_node ( tree_.root_node ) );
+        }
+        for ( std::uint64_t a = 0; a < arity_; ++a ) {
+            std::uint8_t const move = static_cast<std::uint8_t> ( a );
+            for ( NodeID const parent : parents ) {
+                if constexpr ( tree_access::has_arcs<Tree> ) {
+                    auto const arc = tree_.addArc ( parent, tree_.addNode ( ), MoveType{ move } );
+                    if ( blocks_ )
+                        blocks_->append ( parent, arc );
+                }
+                else {
+                    auto const node = tree_.add_node ( parent );
+                    if ( blocks_ )
+                        blocks_->append ( parent, node );
+                }
+            }
+        }
+        return parents;
+    };
+    for ( const std::uint64_t arity : { 2u, 4u, 8u, 16u, 32u, 64u, 128u, 256u } ) {
+        std::uint64_t const parents = children / arity;
+        for ( int list = 0; list < 2; ++list ) {
+            std::string const name =
+                std::string ( tree_name_ ) + "/children/" + list_names[ list ] + "/arity:" + std::to_string ( arity );
+            runner_.add ( name + "/append", [ = ] ( bench::Phases & ) {
+                Tree tree;
+                Blocks blocks;
+                build ( tree, list ? &blocks : nullptr, parents, arity );
+                bench::Measure measure;
+                measure.ops   = children;
+                measure.nodes = nodeCount ( tree );
+                measure.bytes = treeBytes ( tree ) + ( list ? blocks.bytes ( ) : 0u );
+                return measure;
+            } );
+            runner_.add ( name + "/iterate", [ = ] ( bench::Phases & ) {
+                Tree tree;
+                Blocks blocks;
+                auto const nodes = build ( tree, list ? &blocks : nullptr, parents, arity );
+                std::uint64_t sum = 0;
+                plf::nanotimer timer;
+                timer.start ( );
+                for ( int pass = 0; pass < passes; ++pass ) {
+                    for ( auto const parent : nodes ) {
+                        if constexpr ( tree_access::has_arcs<Tree> ) {
+                            if ( list )
+                                blocks.forEach ( parent, [ & ] ( auto const arc_ ) { sum += tree[ arc_ ].value; } );
+                            else
+                                for ( auto it = tree.cbeginOut ( parent ); it.is_valid ( ); ++it )
+                                    sum += tree[ it.id ( ) ].value;
+                        }
+                        else {
+                            if ( list )
+                                blocks.forEach ( parent, [ & ] ( auto const node_ ) { sum += tree[ node_ ].size ( ); } );
+                            else
+                                for ( typename Tree::const_out_iterator it{ tree, parent }; it.is_valid ( ); ++it )
+                                    sum += it->data.size ( );
+                        }
+                    }
+                }
+                bench::Measure measure;
+                measure.ns = timer.get_elapsed_ns ( );
+                bench::keep ( sum );
+                measure.ops   = passes * children;
+                measure.nodes = nodeCount ( tree );
+                measure.bytes = treeBytes ( tree ) + ( list ? blocks.bytes ( ) : 0u );
+                return measure;
+            } );
+        }
+    }
+}
+
+// NUMA placement, with a worker per CPU, pinned to its (possibly simulated) node, see numa.hpp. Shared: one fst tree,
+// grown by a thread on node 0, then uniformly random root-to-leaf descents (the select phase, read-only) by all workers,
+// one op is one descent. Root parallel: a tree per worker, grown by the emulation of main.cpp, one op is one playout.
+// Only the work of the workers is timed, ns/op is the wall time over the ops of all workers.
+template<template<typename> typename Allocator>
+void addNumaCases ( bench::Runner & runner_, numa::Topology const & topology_, char const * allocator_name_ ) {
+    using Tree                       = fst::SearchTree<MoveType, MovesType, Allocator>;
+    constexpr std::uint64_t nodes    = 1u << 20;
+    constexpr std::uint64_t descents = 1u << 16; // Per worker.
+    constexpr Int moves              = 32;
+    constexpr std::uint64_t seed     = 0x5EED'0000'0000'0039;
+    // Runs work_ ( worker ) on a thread per CPU, pinned to the node of the CPU.
+    auto const run_workers = [ topology_ ] ( auto const & work_ ) {
+        std::vector<std::thread> workers;
+        for ( int node = 0, worker = 0; node < topology_.nodes ( ); ++node )
+            for ( std::size_t cpu = 0; cpu < topology_.cpus ( node ).size ( ); ++cpu, ++worker )
+                workers.emplace_back ( [ &topology_, &work_, node, worker ] ( ) {
+                    topology_.pin ( node );
+                    work_ ( worker );
+                } );
+        for ( std::thread & worker : workers )
+            worker.join ( );
+        return workers.size ( );
+    };
+    runner_.add ( std::string ( "fst/numa:shared/alloc:" ) + allocator_name_, [ = ] ( bench::Phases & ) {
+        std::unique_ptr<Tree> tree;
+        std::thread ( [ & ] ( ) {
+            topology_.pin ( 0 );
+            bench::Phases none ( false ); // The counters only count the thread that opened them.
+            ext::buffered_rng rng = ext::rng_stream ( seed, 0u );
+            tree                  = std::make_unique<Tree> ( getMoves ( rng, moves ) );
+            while ( nodeCount ( *tree ) < nodes )
+                playout ( none, *tree, rng, moves );
+        } ).join ( );
+        bench::Measure measure;
+        plf::nanotimer timer;
+        timer.start ( );
+        std::size_t const workers = run_workers ( [ & ] ( int const worker_ ) {
+            ext::buffered_rng rng = ext::rng_stream ( seed, 1u + worker_ );
+            Int leaves            = 0;
+            for ( std::uint64_t d = 0; d < descents; ++d ) {
+                typename Tree::NodeID node = tree->root_node;
+                while ( hasChild ( *tree, node ) )
+                    node = selectChild ( *tree, node, rng );
+                leaves += node.value;
+            }
+            bench::keep ( leaves );
+        } );
+        measure.ns    = timer.get_elapsed_ns ( );
+        measure.ops   = workers * descents;
+        measure.nodes = nodeCount ( *tree );
+        measure.bytes = treeBytes ( *tree );
+        return measure;
+    } );
+    runner_.add ( std::string ( "fst/numa:root-parallel/alloc:" ) + allocator_name_, [ = ] ( bench::Phases & ) {
+        std::size_t workers = 0;
+        for ( int node = 0; node < topology_.nodes ( ); ++node )
+            workers += topology_.cpus ( node ).size ( );
+        std::vector<bench::Measure> measures ( workers );
+        plf::nanotimer timer;
+        timer.start ( );
+        run_workers ( [ & ] ( int const worker_ ) {
+            bench::Phases none ( false ); // The counters only count the thread that opened them.
+            ext::buffered_rng rng = ext::rng_stream ( seed, 1u + worker_ );
+            Tree tree ( getMoves ( rng, moves ) ); // Grown (and touched) by the pinned worker.
+            std::uint64_t playouts = 0;
+            while ( nodeCount ( tree ) < nodes / workers ) {
+                playout ( none, tree, rng, moves );
+                ++playouts;
+            }
+            measures[ worker_ ] = bench::Measure{ playouts, nodeCount ( tree ), treeBytes ( tree ) };
+        } );
+        bench::Measure measure;
+        measure.ns = timer.get_elapsed_ns ( );
+        for ( bench::Measure const & m : measures )
+            measure.ops += m.ops, measure.nodes += m.nodes, measure.bytes += m.bytes;
+        return measure;
+    } );
+}
+
+int main ( int argc, char ** argv ) {
+    // --numa-nodes=<n> simulates n nodes, see numa.hpp, it is taken out before the runner sees the arguments.
+    numa::Topology topology = numa::machine ( );
+    int args = 1;
+    for ( int i = 1; i < argc; ++i ) {
+        if ( not std::strncmp ( argv[ i ], "--numa-nodes=", 13 ) )
+            topology = numa::Topology::simulate ( std::max ( 1, std::atoi ( argv[ i ] + 13 ) ) );
+        else
+            argv[ args++ ] = argv[ i ];
+    }
+    argc = args;
+    bench::Runner runner;
+    addCases<fst::SearchTree<MoveType, MovesType>> ( runner, "fst" );
+    addCases<fsth::SearchTree<MoveType, MovesType>> ( runner, "fsth" );
+    addCases<fsnt::SearchTree<MovesType>> ( runner, "fsnt" );
+    addCases<fsntu::SearchTree<MovesType>> ( runner, "fsntu" );
+#if defined( _WIN32 ) // ast is Windows only, its pool_allocator is VirtualAlloc based.
+    addCases<ast::SearchTree<MoveType, MovesType>> ( runner, "ast" );
+#endif
+    addWorkloadCases<fst::SearchTree<MoveType, MovesType>> ( runner, "fst" );
+    addWorkloadCases<fsth::SearchTree<MoveType, MovesType>> ( runner, "fsth" );
+    addWorkloadCases<fsnt::SearchTree<MovesType>> ( runner, "fsnt" );
+    addWorkloadCases<fsntu::SearchTree<MovesType>> ( runner, "fsntu" );
+    // The same, the nodes and arcs on huge pages, compare the dTLB misses of the select phase with --counters.
+    addCases<fst::SearchTree<MoveType, MovesType, hpa::huge_page_allocator>> ( runner, "fst:huge" );
+    addCases<fsth::SearchTree<MoveType, MovesType, hpa::huge_page_allocator>> ( runner, "fsth:huge" );
+    addCases<fsnt::SearchTree<MovesType, hpa::huge_page_allocator>> ( runner, "fsnt:huge" );
+    addCases<fsntu::SearchTree<MovesType, hpa::huge_page_allocator>> ( runner, "fsntu:huge" );
+    addWorkloadCases<fst::SearchTree<MoveType, MovesType, hpa::huge_page_allocator>> ( runner, "fst:huge" );
+    addWorkloadCases<fsth::SearchTree<MoveType, MovesType, hpa::huge_page_allocator>> ( runner, "fsth:huge" );
+    addWorkloadCases<fsnt::SearchTree<MovesType, hpa::huge_page_allocator>> ( runner, "fsnt:huge" );
+    addWorkloadCases<fsntu::SearchTree<MovesType, hpa::huge_page_allocator>> ( runner, "fsntu:huge" );
+    // The id width, 16-bit ids (small subtrees, up to 2^15 - 1 elements) and 64-bit ids (more than 2^31 - 1 elements).
+    addCases<fst::SearchTree<MoveType, MovesType, std::allocator, std::int16_t>> ( runner, "fst:id16", 1u << 14 );
+    addCases<fsnt::SearchTree<MovesType, std::allocator, std::int16_t>> ( runner, "fsnt:id16", 1u << 14 );
+    addCases<fst::SearchTree<MoveType, MovesType, std::allocator, std::int64_t>> ( runner, "fst:id64" );
+    addCases<fsnt::SearchTree<MovesType, std::allocator, std::int64_t>> ( runner, "fsnt:id64" );
+    // fst without in-lists (Links::tree), the parent arc only.
+    using TreeOnly = fst::SearchTree<MoveType, MovesType, std::allocator, Int, Links::tree>;
+    addCases<TreeOnly> ( runner, "fst:tree" );
+    addWorkloadCases<TreeOnly> ( runner, "fst:tree" );
+    addProbeCases<fst::SearchTree<MoveType, MovesType>> ( runner, "fst" );
+    addProbeCases<fsth::SearchTree<MoveType, MovesType>> ( runner, "fsth" );
+    addProbeCases<TreeOnly> ( runner, "fst:tree" );
+    addChildListCases<fst::SearchTree<MoveType, MovesType>> ( runner, "fst" );
+    addChildListCases<fsnt::SearchTree<MovesType>> ( runner, "fsnt" );
+    addExpansionCases<fst::SearchTree<MoveType, MovesType>> ( runner, "fst" );
+    addExpansionCases<fsth::SearchTree<MoveType, MovesType>> ( runner, "fsth" );
+    addExpansionCases<fsnt::SearchTree<MovesType>> ( runner, "fsnt" );
+    addExpansionCases<fsntu::SearchTree<MovesType>> ( runner, "fsntu" );
+    addWideningCases<fst::SearchTree<MoveType, MovesType>> ( runner, "fst" );
+    addWideningCases<fsnt::SearchTree<MovesType>> ( runner, "fsnt" );
+    addWideningCases<fsntu::SearchTree<MovesType>> ( runner, "fsntu" );
+    addBackupCases<fsnt::SearchTree<StatsType>> ( runner, "fsnt" );
+    addBackupCases<fsntu::SearchTree<StatsType>> ( runner, "fsntu" );
+    addDagBackupCases ( runner );
+    addWalkCases<fst::SearchTree<MoveType, MovesType>> ( runner, "fst" );
+    addWalkCases<fsth::SearchTree<MoveType, MovesType>> ( runner, "fsth" );
+    addTopologicalSortCases ( runner );
+    addParallelCases<fst::SearchTree<MoveType, MovesType>> ( runner, "fst" );
+    addParallelCases<fsth::SearchTree<MoveType, MovesType>> ( runner, "fsth" );
+    addPruneCases<fst::SearchTree<MoveType, MovesType>> ( runner, "fst" );
+    addPruneCases<fsnt::SearchTree<MovesType>> ( runner, "fsnt" );
+    addPruneCases<fsntu::SearchTree<MovesType>> ( runner, "fsntu" );
+    addNumaCases<std::allocator> ( runner, topology, "first-touch" );
+    addNumaCases<numa::interleaved_allocator> ( runner, topology, "interleave" );
+    addNumaCases<numa::local_allocator> ( runner, topology, "local" );
+    std::printf ( "numa: %s\n", topology.str ( ).c_str ( ) );
+    return runner.run ( argc, argv );
+}
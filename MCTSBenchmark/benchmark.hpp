@@ -0,0 +1,174 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined( _WIN32 )
+#    ifndef NOGDI
+#        define NOGDI // Otherwise Arc is defined.
+#    endif
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <Windows.h>
+#    include <Psapi.h>
+#else
+#    include <sys/resource.h>
+#endif
+
+#include <plf/plf_nanotimer.h>
+
+#include "perf_counters.hpp"
+
+// A minimal harness in the spirit of Google Benchmark: named cases, a filter, repetitions, one row per case.
+namespace bench {
+
+// The peak resident set (working set on Windows) of the process so far, in bytes.
+[[nodiscard]] inline std::size_t peakRss ( ) noexcept {
+#if defined( _WIN32 )
+    PROCESS_MEMORY_COUNTERS pmc;
+    return GetProcessMemoryInfo ( GetCurrentProcess ( ), &pmc, sizeof ( pmc ) ) ? pmc.PeakWorkingSetSize : 0;
+#else
+    rusage usage;
+    if ( getrusage ( RUSAGE_SELF, &usage ) )
+        return 0;
+#    if defined( __APPLE__ )
+    return static_cast<std::size_t> ( usage.ru_maxrss ); // Bytes.
+#    else
+    return static_cast<std::size_t> ( usage.ru_maxrss ) * 1024; // KiB.
+#    endif
+#endif
+}
+
+// Keeps a result the compiler could otherwise discard, and with it the computation leading up to it.
+template<typename Type>
+void keep ( const Type value_ ) noexcept {
+    [[maybe_unused]] static volatile Type sink;
+    sink = value_;
+}
+
+// What a case reports, the harness times it.
+struct Measure {
+    std::uint64_t ops   = 0; // The unit of ns/op, an emulated playout.
+    std::uint64_t nodes = 0; // Size of the tree at the end.
+    std::size_t bytes   = 0; // Memory held by the tree at the end.
+    double ns           = 0; // The time of the part of the case that is measured, if set, otherwise the whole case is.
+};
+
+// A case is timed as a whole (unless it times itself, see Measure), the tree is built from scratch in every repetition. The
+// peak RSS column is the high-water mark of the process, i.e. it only grows, run a single case (--filter) to get the peak of
+// that case.
+class Runner {
+
+    struct Case {
+        std::string name;
+        std::function<Measure ( Phases & )> run;
+    };
+
+    std::vector<Case> m_cases;
+
+    static void printPhases ( Phases const & phases_ ) {
+        for ( int p = 0; p < static_cast<int> ( Phase::size ); ++p ) {
+            const Phase phase        = static_cast<Phase> ( p );
+            const std::uint64_t ops  = phases_.ops ( phase );
+            const CounterValues vals = phases_.values ( phase );
+            if ( not ops )
+                continue;
+            std::printf ( "  %-10s %10llu ops", phase_names[ p ], static_cast<unsigned long long> ( ops ) );
+            for ( std::size_t c = 0; c < vals.value.size ( ); ++c ) {
+                if ( vals.valid[ c ] )
+                    std::printf ( "  %s/op %.1f", counter_names[ c ], double ( vals.value[ c ] ) / ops );
+                else
+                    std::printf ( "  %s/op n/a", counter_names[ c ] );
+            }
+            std::printf ( "\n" );
+        }
+    }
+
+    public:
+    void add ( std::string name_, std::function<Measure ( Phases & )> run_ ) {
+        m_cases.push_back ( { std::move ( name_ ), std::move ( run_ ) } );
+    }
+
+    // Accepts --filter=<substring>, --repetitions=<n> and --counters, the fastest repetition is reported. With
+    // --counters every case is followed by the hardware counters per operation of each phase it went through.
+    int run ( int argc_, char ** argv_ ) const {
+        std::string filter;
+        int repetitions = 3;
+        bool counters   = false;
+        for ( int i = 1; i < argc_; ++i ) {
+            if ( not std::strncmp ( argv_[ i ], "--filter=", 9 ) )
+                filter = argv_[ i ] + 9;
+            else if ( not std::strncmp ( argv_[ i ], "--repetitions=", 14 ) )
+                repetitions = std::max ( 1, std::atoi ( argv_[ i ] + 14 ) );
+            else if ( not std::strcmp ( argv_[ i ], "--counters" ) )
+                counters = true;
+            else {
+                // --numa-nodes=<n> is taken out by main, before the runner sees the arguments.
+                std::fprintf ( stderr, "usage: %s [--filter=<substring>] [--repetitions=<n>] [--counters] [--numa-nodes=<n>]\n",
+                               argv_[ 0 ] );
+                return EXIT_FAILURE;
+            }
+        }
+        if ( counters and not Phases{ true }.valid ( ) )
+            std::fprintf ( stderr, "hardware counters unavailable (not Linux, or see /proc/sys/kernel/perf_event_paranoid)\n" );
+        std::printf ( "%-40s %12s %14s %12s %12s\n", "Benchmark", "ns/op", "nodes/s", "bytes/node", "peak RSS MiB" );
+        std::printf ( "%s\n", std::string ( 94, '-' ).c_str ( ) );
+        for ( Case const & c : m_cases ) {
+            if ( filter.size ( ) and std::string::npos == c.name.find ( filter ) )
+                continue;
+            Measure best;
+            double best_ns = 0.0;
+            std::unique_ptr<Phases> best_phases;
+            for ( int r = 0; r < repetitions; ++r ) {
+                auto phases = std::make_unique<Phases> ( counters );
+                plf::nanotimer timer;
+                timer.start ( );
+                const Measure m = c.run ( *phases );
+                const double ns = m.ns > 0 ? m.ns : timer.get_elapsed_ns ( );
+                if ( not r or ns < best_ns )
+                    best_ns = ns, best = m, best_phases = std::move ( phases );
+            }
+            std::printf ( "%-40s %12.1f %14.0f %12.1f %12.1f\n", c.name.c_str ( ),
+                          best_ns / std::max<std::uint64_t> ( best.ops, 1 ), best.nodes / ( best_ns * 1e-9 ),
+                          double ( best.bytes ) / std::max<std::uint64_t> ( best.nodes, 1 ), peakRss ( ) / ( 1024.0 * 1024.0 ) );
+            if ( best_phases->enabled ( ) )
+                printPhases ( *best_phases );
+        }
+        return EXIT_SUCCESS;
+    }
+};
+
+} // namespace bench
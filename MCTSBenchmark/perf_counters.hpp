@@ -0,0 +1,192 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <array>
+#include <memory>
+
+#if defined( __linux__ )
+#    include <linux/perf_event.h>
+#    include <sys/ioctl.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif
+
+// Opt-in hardware counters per phase of the emulation, on Linux through perf_event_open, elsewhere the groups fail to
+// open and the phases only count operations. Counting is restricted to user space; enabling and disabling a group is
+// an ioctl, i.e. a few hundred ns of (uncounted) overhead per phase, so the timings of an instrumented run are off.
+namespace bench {
+
+enum class Counter : int { cycles, instructions, llc_misses, dtlb_misses, branch_misses, size };
+
+inline constexpr std::array<char const *, static_cast<std::size_t> ( Counter::size )> counter_names{
+    "cycles", "instr", "LLC-miss", "dTLB-miss", "br-miss"
+};
+
+struct CounterValues {
+    std::array<std::uint64_t, static_cast<std::size_t> ( Counter::size )> value{ };
+    std::array<bool, static_cast<std::size_t> ( Counter::size )> valid{ }; // The event could be opened.
+};
+
+// A perf_event group, all counters start and stop together. The first counter (cycles) leads the group.
+class CounterGroup {
+
+    std::array<int, static_cast<std::size_t> ( Counter::size )> m_fd;
+
+#if defined( __linux__ )
+    [[nodiscard]] static int open ( std::uint32_t type_, std::uint64_t config_, int group_fd_ ) noexcept {
+        perf_event_attr attr;
+        std::memset ( &attr, 0, sizeof ( attr ) );
+        attr.size           = sizeof ( attr );
+        attr.type           = type_;
+        attr.config         = config_;
+        attr.disabled       = group_fd_ < 0; // Only the leader starts disabled, the others follow it.
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int> ( syscall ( __NR_perf_event_open, &attr, 0, -1, group_fd_, 0 ) );
+    }
+#endif
+
+    public:
+    CounterGroup ( ) noexcept {
+        m_fd.fill ( -1 );
+#if defined( __linux__ )
+        constexpr std::uint64_t dtlb_read_miss = PERF_COUNT_HW_CACHE_DTLB | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) |
+                                                 ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+        if ( ( m_fd[ 0 ] = open ( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1 ) ) < 0 )
+            return;
+        m_fd[ 1 ] = open ( PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, m_fd[ 0 ] );
+        m_fd[ 2 ] = open ( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, m_fd[ 0 ] );
+        m_fd[ 3 ] = open ( PERF_TYPE_HW_CACHE, dtlb_read_miss, m_fd[ 0 ] );
+        m_fd[ 4 ] = open ( PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, m_fd[ 0 ] );
+#endif
+    }
+
+    CounterGroup ( CounterGroup const & ) = delete;
+    CounterGroup & operator= ( CounterGroup const & ) = delete;
+
+    ~CounterGroup ( ) noexcept {
+#if defined( __linux__ )
+        for ( int const fd : m_fd )
+            if ( fd >= 0 )
+                close ( fd );
+#endif
+    }
+
+    [[nodiscard]] bool valid ( ) const noexcept { return m_fd[ 0 ] >= 0; }
+
+    void start ( ) noexcept {
+#if defined( __linux__ )
+        ioctl ( m_fd[ 0 ], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+#endif
+    }
+    void stop ( ) noexcept {
+#if defined( __linux__ )
+        ioctl ( m_fd[ 0 ], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP );
+#endif
+    }
+
+    // The totals so far, scaled up if the kernel had to multiplex the group.
+    [[nodiscard]] CounterValues read ( ) const noexcept {
+        CounterValues values;
+#if defined( __linux__ )
+        std::uint64_t buffer[ 3 + static_cast<std::size_t> ( Counter::size ) ]; // nr, time enabled, time running, values.
+        if ( not valid ( ) or ::read ( m_fd[ 0 ], buffer, sizeof ( buffer ) ) <= 0 )
+            return values;
+        const double scale = buffer[ 2 ] ? double ( buffer[ 1 ] ) / double ( buffer[ 2 ] ) : 1.0;
+        std::size_t v      = 3; // The values come in the order the events were opened, skipping the failed ones.
+        for ( std::size_t c = 0; c < m_fd.size ( ); ++c ) {
+            if ( m_fd[ c ] >= 0 and v < 3 + buffer[ 0 ] ) {
+                values.value[ c ] = static_cast<std::uint64_t> ( double ( buffer[ v++ ] ) * scale );
+                values.valid[ c ] = true;
+            }
+        }
+#endif
+        return values;
+    }
+};
+
+enum class Phase : int { select, expand, reroot, serialize, size };
+
+inline constexpr std::array<char const *, static_cast<std::size_t> ( Phase::size )> phase_names{ "select", "expand", "reroot",
+                                                                                                 "serialize" };
+
+// One counter group per phase, only the group of the running phase is enabled. Disabled (the default), start and stop
+// are a test of a null pointer.
+class Phases {
+
+    std::array<std::unique_ptr<CounterGroup>, static_cast<std::size_t> ( Phase::size )> m_groups;
+    std::array<std::uint64_t, static_cast<std::size_t> ( Phase::size )> m_ops{ };
+
+    public:
+    explicit Phases ( bool enabled_ = false ) {
+        if ( enabled_ )
+            for ( auto & group : m_groups )
+                group = std::make_unique<CounterGroup> ( );
+    }
+
+    [[nodiscard]] bool enabled ( ) const noexcept { return static_cast<bool> ( m_groups[ 0 ] ); }
+    [[nodiscard]] bool valid ( ) const noexcept { return enabled ( ) and m_groups[ 0 ]->valid ( ); }
+
+    void start ( Phase const phase_ ) noexcept {
+        if ( auto & group = m_groups[ static_cast<std::size_t> ( phase_ ) ]; group and group->valid ( ) )
+            group->start ( );
+    }
+    void stop ( Phase const phase_ ) noexcept {
+        if ( auto & group = m_groups[ static_cast<std::size_t> ( phase_ ) ]; group ) {
+            if ( group->valid ( ) )
+                group->stop ( );
+            ++m_ops[ static_cast<std::size_t> ( phase_ ) ];
+        }
+    }
+
+    [[nodiscard]] std::uint64_t ops ( Phase const phase_ ) const noexcept { return m_ops[ static_cast<std::size_t> ( phase_ ) ]; }
+    [[nodiscard]] CounterValues values ( Phase const phase_ ) const noexcept {
+        auto const & group = m_groups[ static_cast<std::size_t> ( phase_ ) ];
+        return group ? group->read ( ) : CounterValues{ };
+    }
+};
+
+class ScopedPhase {
+
+    Phases & m_phases;
+    Phase m_phase;
+
+    public:
+    ScopedPhase ( Phases & phases_, Phase const phase_ ) noexcept : m_phases{ phases_ }, m_phase{ phase_ } {
+        m_phases.start ( m_phase );
+    }
+    ~ScopedPhase ( ) noexcept { m_phases.stop ( m_phase ); }
+
+    ScopedPhase ( ScopedPhase const & ) = delete;
+    ScopedPhase & operator= ( ScopedPhase const & ) = delete;
+};
+
+} // namespace bench
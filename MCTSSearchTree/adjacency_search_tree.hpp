@@ -267,10 +267,10 @@ class SearchTree {
         return * arc_;
     }
     [[ nodiscard ]] NodeData & operator [ ] ( const NodeID node_ ) noexcept {
-        return * node_;
+        return node_->data;
     }
     [[ nodiscard ]] const NodeData & operator [ ] ( const NodeID node_ ) const noexcept {
-        return * node_;
+        return node_->data;
     }
 
     [[ nodiscard ]] const std::size_t nodeNum ( ) const noexcept {
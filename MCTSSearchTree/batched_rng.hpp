@@ -0,0 +1,238 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <limits>
+
+#include "uniform_int_distribution_fast.hpp"
+
+namespace ext {
+
+// Four independent xoshiro256++ streams, kept as a structure of arrays, so that the state update of all lanes is one
+// straight-line block of 64-bit adds, xors, shifts and rotates, which compilers turn into AVX2 (or SSE2, two lanes at a
+// time) without intrinsics. Splitmix64 needs a 64-bit multiply per value, which only AVX-512 vectorizes, hence it is
+// only used for seeding. The lanes are one xoshiro256 sequence, each 2^128 values (a jump) ahead of the previous one.
+class xoshiro256x4 {
+
+    static constexpr std::size_t lanes = 4;
+
+    alignas ( 32 ) std::uint64_t s0[ lanes ], s1[ lanes ], s2[ lanes ], s3[ lanes ];
+
+    [[nodiscard]] static constexpr std::uint64_t rotl ( const std::uint64_t x_, const int k_ ) noexcept {
+        return ( x_ << k_ ) | ( x_ >> ( 64 - k_ ) );
+    }
+
+    [[nodiscard]] static constexpr std::uint64_t splitmix64 ( std::uint64_t & s_ ) noexcept {
+        std::uint64_t z = ( s_ += 0x9E3779B97F4A7C15 );
+        z               = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9;
+        z               = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EB;
+        return z ^ ( z >> 31 );
+    }
+
+    void jump_lane ( const std::size_t l_, const std::uint64_t ( &poly_ )[ 4 ] ) noexcept {
+        std::uint64_t t0 = 0, t1 = 0, t2 = 0, t3 = 0;
+        for ( const std::uint64_t p : poly_ ) {
+            for ( int b = 0; b < 64; ++b ) {
+                if ( p & std::uint64_t{ 1 } << b ) {
+                    t0 ^= s0[ l_ ];
+                    t1 ^= s1[ l_ ];
+                    t2 ^= s2[ l_ ];
+                    t3 ^= s3[ l_ ];
+                }
+                const std::uint64_t t = s1[ l_ ] << 17;
+                s2[ l_ ] ^= s0[ l_ ];
+                s3[ l_ ] ^= s1[ l_ ];
+                s1[ l_ ] ^= s2[ l_ ];
+                s0[ l_ ] ^= s3[ l_ ];
+                s2[ l_ ] ^= t;
+                s3[ l_ ] = rotl ( s3[ l_ ], 45 );
+            }
+        }
+        s0[ l_ ] = t0;
+        s1[ l_ ] = t1;
+        s2[ l_ ] = t2;
+        s3[ l_ ] = t3;
+    }
+
+    static constexpr std::uint64_t jump_poly[ 4 ]      = { 0x180EC6D33CFD0ABA, 0xD5A61266F0C9392C, 0xA9582618E03FC9AA,
+                                                           0x39ABDC4529B1661C };
+    static constexpr std::uint64_t long_jump_poly[ 4 ] = { 0x76E15D3EFEFDCBBF, 0xC5004E441C522FB3, 0x77710069854EE241,
+                                                           0x39109BB02ACBE635 };
+
+    public:
+    using result_type = std::uint64_t;
+
+    explicit xoshiro256x4 ( std::uint64_t seed_ = 0xBE1C0467EBA5FAC1 ) noexcept { seed ( seed_ ); }
+
+    void seed ( std::uint64_t seed_ ) noexcept {
+        s0[ 0 ] = splitmix64 ( seed_ );
+        s1[ 0 ] = splitmix64 ( seed_ );
+        s2[ 0 ] = splitmix64 ( seed_ );
+        s3[ 0 ] = splitmix64 ( seed_ );
+        for ( std::size_t l = 1; l < lanes; ++l ) {
+            s0[ l ] = s0[ l - 1 ];
+            s1[ l ] = s1[ l - 1 ];
+            s2[ l ] = s2[ l - 1 ];
+            s3[ l ] = s3[ l - 1 ];
+            jump_lane ( l, jump_poly );
+        }
+    }
+
+    // Advances every lane by 2^192 values. As the lanes occupy 4 * 2^128 values of the sequence, consecutive long jumps
+    // yield 2^64 non-overlapping streams.
+    void long_jump ( ) noexcept {
+        for ( std::size_t l = 0; l < lanes; ++l )
+            jump_lane ( l, long_jump_poly );
+    }
+
+    // Fills [ first_, first_ + n_ ), n_ a multiple of 4.
+    void fill ( std::uint64_t * first_, const std::size_t n_ ) noexcept {
+        assert ( not( n_ % lanes ) );
+        for ( std::uint64_t * const last = first_ + n_; first_ != last; first_ += lanes ) {
+            for ( std::size_t l = 0; l < lanes; ++l ) {
+                first_[ l ]           = rotl ( s0[ l ] + s3[ l ], 23 ) + s0[ l ];
+                const std::uint64_t t = s1[ l ] << 17;
+                s2[ l ] ^= s0[ l ];
+                s3[ l ] ^= s1[ l ];
+                s1[ l ] ^= s2[ l ];
+                s0[ l ] ^= s3[ l ];
+                s2[ l ] ^= t;
+                s3[ l ] = rotl ( s3[ l ], 45 );
+            }
+        }
+    }
+
+    [[nodiscard]] static constexpr std::size_t width ( ) noexcept { return lanes; }
+};
+
+// Hands out the values of Engine one at a time from a buffer of Size values, which is refilled in one batch when
+// exhausted. Satisfies UniformRandomBitGenerator, so it drops in where sax::splitmix64 was used (std::shuffle etc.).
+template<typename Engine = xoshiro256x4, std::size_t Size = 256>
+class buffered_generator {
+
+    static_assert ( Size and not( Size % Engine::width ( ) ), "the buffer size must be a multiple of the engine width" );
+
+    Engine m_engine;
+    std::size_t m_index = Size;
+    alignas ( 64 ) std::uint64_t m_buffer[ Size ];
+
+    void refill ( ) noexcept {
+        m_engine.fill ( m_buffer, Size );
+        m_index = 0;
+    }
+
+    public:
+    using result_type = std::uint64_t;
+
+    explicit buffered_generator ( std::uint64_t seed_ = 0xBE1C0467EBA5FAC1 ) noexcept : m_engine{ seed_ } {}
+    // Stream stream_ of the sequence seeded by seed_, see rng_stream.
+    buffered_generator ( const std::uint64_t seed_, const std::uint64_t stream_ ) noexcept : m_engine{ seed_ } {
+        for ( std::uint64_t i = 0; i < stream_; ++i )
+            m_engine.long_jump ( );
+    }
+
+    void seed ( const std::uint64_t seed_ ) noexcept {
+        m_engine.seed ( seed_ );
+        m_index = Size;
+    }
+
+    // Discards what is buffered and moves on to the next stream.
+    void long_jump ( ) noexcept {
+        m_engine.long_jump ( );
+        m_index = Size;
+    }
+
+    [[nodiscard]] static constexpr result_type min ( ) noexcept { return std::numeric_limits<result_type>::min ( ); }
+    [[nodiscard]] static constexpr result_type max ( ) noexcept { return std::numeric_limits<result_type>::max ( ); }
+
+    [[nodiscard]] result_type operator( ) ( ) noexcept {
+        if ( m_index == Size )
+            refill ( );
+        return m_buffer[ m_index++ ];
+    }
+
+    // Lemire's nearly divisionless bounded draw in [ 0, range_ ), as in
+    // uniform_int_distribution_fast::bounded_range_lemire_oneill, on the upper 32 bits of a buffered value; the modulo is
+    // only computed on the (rare) rejection path.
+    [[nodiscard]] std::uint32_t bounded ( const std::uint32_t range_ ) noexcept {
+        assert ( range_ );
+        using double_width = typename detail::double_width_integer<std::uint32_t>::type;
+        double_width m     = double_width ( operator( ) ( ) >> 32 ) * range_;
+        if ( std::uint32_t ( m ) < range_ ) {
+            const std::uint32_t t = ( 0u - range_ ) % range_;
+            while ( std::uint32_t ( m ) < t )
+                m = double_width ( operator( ) ( ) >> 32 ) * range_;
+        }
+        return std::uint32_t ( m >> 32 );
+    }
+
+    // Batched variant of bounded, writes n_ draws in [ 0, range_ ) to first_. The threshold is computed once and the
+    // multiply loop runs without branches over the buffer; only the lanes that were rejected are redrawn.
+    void bounded ( std::uint32_t * first_, const std::size_t n_, const std::uint32_t range_ ) noexcept {
+        assert ( range_ );
+        using double_width    = typename detail::double_width_integer<std::uint32_t>::type;
+        const std::uint32_t t = ( 0u - range_ ) % range_;
+        std::size_t i         = 0;
+        while ( i < n_ ) {
+            if ( m_index == Size )
+                refill ( );
+            const std::size_t c = std::min ( n_ - i, Size - m_index );
+            std::uint32_t rejected = 0;
+            for ( std::size_t j = 0; j < c; ++j ) {
+                const double_width m = double_width ( m_buffer[ m_index + j ] >> 32 ) * range_;
+                first_[ i + j ]      = std::uint32_t ( m >> 32 );
+                rejected |= std::uint32_t ( m ) < t;
+            }
+            if ( rejected ) { // Mark the rejected lanes with the (impossible) value range_, then redraw them.
+                for ( std::size_t j = 0; j < c; ++j )
+                    if ( std::uint32_t ( double_width ( m_buffer[ m_index + j ] >> 32 ) * range_ ) < t )
+                        first_[ i + j ] = range_;
+                m_index += c;
+                for ( std::size_t j = 0; j < c; ++j )
+                    if ( first_[ i + j ] == range_ )
+                        first_[ i + j ] = bounded ( range_ );
+                i += c;
+                continue;
+            }
+            m_index += c;
+            i += c;
+        }
+    }
+};
+
+using buffered_rng = buffered_generator<>;
+
+// The generator of worker worker_ for a run seeded with master_seed_. The streams of the workers are long jumps apart
+// in one xoshiro256 sequence, so they never overlap and a run depends on the master seed and the worker count only,
+// not on thread scheduling. Each worker owns its generator and passes it down, nothing is shared between threads.
+[[nodiscard]] inline buffered_rng rng_stream ( const std::uint64_t master_seed_, const std::uint64_t worker_ ) noexcept {
+    return buffered_rng{ master_seed_, worker_ };
+}
+} // namespace ext
@@ -48,8 +48,6 @@
 
 #include <plf/plf_nanotimer.h>
 
-#include <sax/splitmix.hpp> // https://github.com/degski/Sax/blob/master/splitmix.hpp
-#include <sax/singleton.hpp>
 #include "flat_search_tree.hpp"
 #include "flat_search_tree_hash.hpp"
 #include "adjacency_search_tree.hpp"
@@ -57,23 +55,20 @@
 #include "flat_search_ntree_uni.hpp"
 #include "link.hpp"
 #include "path.hpp"
+#include <sax/uniform_int_distribution.hpp>
+#include "batched_rng.hpp"
+#include "uniform_int_distribution_fast.hpp"
 #include "mcts_emu.hpp"
 #include "moves.hpp"
 
-sax::singleton<sax::splitmix64> rng;
-
 int main ( ) {
 
     using namespace fsntu;
 
-    auto x = rng.instance ( 123u );
-
     using Tree = SearchTree<int>;
     using Node = typename Tree::NodeID;
     using It   = typename Tree::const_out_iterator;
 
-    std::cout << sizeof ( Tree::Node ) << nl; // 512
-
     auto hash = 0x14cd518c672612a9;
 
     Tree t ( 1 );
@@ -102,6 +97,8 @@ int main ( ) {
 
     std::cout << t.size ( ) << nl;
 
+    std::cout << t.profile ( ) << nl;
+
     for ( It it{ t, t.root_node }; it.is_valid ( ); ++it )
         std::cout << it->data << ' ';
 
@@ -126,17 +123,14 @@ int main986986 ( ) {
 
     using namespace fst;
 
-    auto x = rng.instance ( 123u );
+    ext::buffered_rng rng = ext::rng_stream ( 123u, 0u ); // Worker 0 of the run seeded with 123.
 
     std::bernoulli_distribution b_dist1 ( 0.66 );
     std::bernoulli_distribution b_dist2 ( 0.33 );
 
     using Tree = SearchTree<MoveType, MovesType>;
 
-    std::cout << sizeof ( Tree::Arc ) << nl;  // 32
-    std::cout << sizeof ( Tree::Node ) << nl; // 512
-
-    Tree t ( getMoves ( ) ); // Root Moves.
+    Tree t ( getMoves ( rng ) ); // Root Moves.
 
     std::uint64_t cnt = 1024 * 1024 * 4;
 
@@ -151,14 +145,14 @@ int main986986 ( ) {
 
         while ( --cnt ) {
 
-            while ( b_dist1 ( rng.instance ( ) ) and hasChild ( t, node ) ) {
+            while ( b_dist1 ( rng ) and hasChild ( t, node ) ) {
 
-                node = selectChild ( t, node );
+                node = selectChild ( t, node, rng );
             }
 
-            if ( b_dist2 ( rng.instance ( ) ) and hasMoves ( t, node ) ) {
+            if ( b_dist2 ( rng ) and hasMoves ( t, node ) ) {
 
-                addChild ( t, node );
+                addChild ( t, node, rng );
             }
 
             node = t.root_node;
@@ -169,7 +163,53 @@ int main986986 ( ) {
 
     std::cout << t.arcNum ( ) << " - " << t.nodeNum ( ) << nl << nl;
 
+    std::cout << t.profile ( ) << nl;
+
     std::cout << static_cast<std::uint64_t> ( elapsed ) << nl;
 
     return EXIT_SUCCESS;
 }
+
+// Times n draws of Dist over [ 0, b_ ], one at a time and (if the distribution has it) in bulk into buffer_, in ns per
+// draw.
+template<typename Dist, typename Gen>
+void benchmarkDistribution ( char const * name_, Gen & rng_, const typename Dist::result_type b_, const std::size_t n_,
+                             std::vector<typename Dist::result_type> & buffer_ ) {
+    using result_type = typename Dist::result_type;
+    buffer_.resize ( n_ );
+    Dist dist ( 0, b_ );
+    plf::nanotimer timer;
+    result_type sum = 0;
+    timer.start ( );
+    for ( std::size_t i = 0; i < n_; ++i )
+        sum += dist ( rng_ );
+    const double single = timer.get_elapsed_ns ( ) / n_;
+    std::cout << name_ << ' ' << std::numeric_limits<result_type>::digits << "-bit, [0, " << b_ << "]: " << single << " ns";
+    if constexpr ( std::is_same<Dist, ext::uniform_int_distribution_fast<result_type>>::value ) {
+        timer.start ( );
+        dist.generate ( rng_, std::begin ( buffer_ ), n_ );
+        std::cout << ", generate " << timer.get_elapsed_ns ( ) / n_ << " ns";
+        sum += buffer_.back ( );
+    }
+    std::cout << " (" << sum % 10 << ")" << nl; // Keeps the loop alive.
+}
+
+template<typename Type>
+void benchmarkDistributions ( ext::buffered_rng & rng_, const Type b_ ) {
+    constexpr std::size_t n = 10'000'000;
+    std::vector<Type> buffer;
+    benchmarkDistribution<std::uniform_int_distribution<Type>> ( "std ", rng_, b_, n, buffer );
+    benchmarkDistribution<sax::uniform_int_distribution<Type>> ( "sax ", rng_, b_, n, buffer );
+    benchmarkDistribution<ext::uniform_int_distribution_fast<Type>> ( "fast", rng_, b_, n, buffer );
+}
+
+int main_distribution ( ) {
+    ext::buffered_rng rng = ext::rng_stream ( 123u, 0u );
+    // Small (move lists), awkward (just over a power of 2, most rejections) and large ranges.
+    for ( std::uint32_t b : { 63u, 0x8000'0000u, 0xFFFF'FFFEu } )
+        benchmarkDistributions<std::uint32_t> ( rng, b );
+    for ( std::uint64_t b :
+          { std::uint64_t{ 63 }, std::uint64_t{ 0x8000'0000'0000'0000 }, std::uint64_t{ 0xFFFF'FFFF'FFFF'FFFE } } )
+        benchmarkDistributions<std::uint64_t> ( rng, b );
+    return EXIT_SUCCESS;
+}
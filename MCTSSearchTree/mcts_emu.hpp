@@ -32,15 +32,13 @@
 #include <iostream>
 #include <numeric>
 #include <random>
+#include <tuple>
 #include <type_traits>
 
-#include <sax/splitmix.hpp> // https://github.com/degski/Sax/blob/master/splitmix.hpp
-#include <sax/uniform_int_distribution.hpp>
-#include <sax/singleton.hpp>
+#include "tree_access.hpp"
+#include "batched_rng.hpp"
 #include "moves.hpp"
 
-extern sax::singleton<sax::splitmix64> rng;
-
 struct MoveType {
     std::uint8_t value;
 
@@ -51,24 +49,77 @@ struct MoveType {
 
 using MovesType = Moves<MoveType, 64>;
 
-[[nodiscard]] MovesType getMoves ( ) noexcept {
+// Moves 0 .. n_ - 1, shuffled, n_ being the branching factor of the emulated game.
+template<typename Rng>
+[[nodiscard]] inline MovesType getMoves ( Rng & rng_, const Int n_ = MovesType{ }.capacity ( ) ) noexcept {
+    assert ( n_ <= MovesType{ }.capacity ( ) );
     MovesType moves;
-    moves.size ( ) = moves.capacity ( );
+    moves.size ( ) = n_;
     std::iota<MoveType *, std::uint8_t> ( std::begin ( moves ), std::end ( moves ), 0u );
-    std::shuffle ( std::begin ( moves ), std::end ( moves ), rng.instance ( ) );
+    std::shuffle ( std::begin ( moves ), std::end ( moves ), rng_ );
     return moves;
 }
 
-template<typename Tree, typename N>
-[[maybe_unused]] N addChild ( Tree & tree_, const N source_ ) noexcept {
-    const N target = tree_.addNode ( getMoves ( ) );
-    tree_.addArc ( source_, target, tree_[ source_ ].take ( ) );
-    return target;
+// The helpers below drive all trees: fst and ast (arcs), fsth (arcs and a hash per node, the emulation hashes are
+// random, so there are no transpositions), fsnt and fsntu (nodes only, the move is taken but not stored).
+
+template<typename Tree, typename N, typename Rng>
+[[maybe_unused]] N addChild ( Tree & tree_, const N source_, Rng & rng_, const Int moves_ = MovesType{ }.capacity ( ) ) {
+    if constexpr ( tree_access::has_transpositions<Tree> ) { // fsth.
+        using Hash     = std::remove_const_t<decltype ( Tree::root_hash )>;
+        const N target = tree_.addNode ( static_cast<Hash> ( rng_ ( ) ), getMoves ( rng_, moves_ ) );
+        tree_.addArc ( source_, target, tree_[ source_ ].take ( rng_ ) );
+        return target;
+    }
+    else if constexpr ( tree_access::has_arcs<Tree> ) { // fst, ast.
+        const N target = tree_.addNode ( getMoves ( rng_, moves_ ) );
+        tree_.addArc ( source_, target, tree_[ source_ ].take ( rng_ ) );
+        return target;
+    }
+    else { // fsnt, fsntu.
+        [[maybe_unused]] const MoveType move = tree_[ source_ ].take ( rng_ );
+        return tree_.add_node ( source_, getMoves ( rng_, moves_ ) );
+    }
 }
 
-template<typename Tree, typename N>
-void addLink ( Tree & tree_, const N source_, const N target_ ) noexcept {
-    tree_.addArc ( source_, target_, tree_.data ( source_ ).take ( ) );
+// The generator of the bulk expansion of the flat trees (addChildren, add_children) of source_, the i-th child takes a
+// move from source_ and gets moves_ moves. The trees reserve the vectors before the first call, so tree_[ source_ ]
+// stays put.
+template<typename Tree, typename N, typename Rng>
+[[nodiscard]] auto childGenerator ( Tree & tree_, const N source_, Rng & rng_, const Int moves_ = MovesType{ }.capacity ( ) ) {
+    static_assert ( not std::is_pointer<N>::value, "the flat trees only" );
+    if constexpr ( tree_access::has_transpositions<Tree> ) { // fsth.
+        using Hash = std::remove_const_t<decltype ( Tree::root_hash )>;
+        return [ &tree_, source_, &rng_, moves_ ] ( std::size_t ) {
+            return std::tuple{ static_cast<Hash> ( rng_ ( ) ), tree_[ source_ ].take ( rng_ ), getMoves ( rng_, moves_ ) };
+        };
+    }
+    else if constexpr ( tree_access::has_arcs<Tree> ) { // fst.
+        return [ &tree_, source_, &rng_, moves_ ] ( std::size_t ) {
+            return std::pair{ tree_[ source_ ].take ( rng_ ), getMoves ( rng_, moves_ ) };
+        };
+    }
+    else { // fsnt, fsntu.
+        return [ &tree_, source_, &rng_, moves_ ] ( std::size_t ) {
+            [[maybe_unused]] const MoveType move = tree_[ source_ ].take ( rng_ );
+            return getMoves ( rng_, moves_ );
+        };
+    }
+}
+
+// All (remaining) moves of source_ at once, the children are contiguous.
+template<typename Tree, typename N, typename Rng>
+void addChildren ( Tree & tree_, const N source_, Rng & rng_, const Int moves_ = MovesType{ }.capacity ( ) ) {
+    std::size_t const count = static_cast<std::size_t> ( tree_[ source_ ].size ( ) );
+    if constexpr ( tree_access::has_arcs<Tree> )
+        tree_.addChildren ( source_, count, childGenerator ( tree_, source_, rng_, moves_ ) );
+    else
+        tree_.add_children ( source_, count, childGenerator ( tree_, source_, rng_, moves_ ) );
+}
+
+template<typename Tree, typename N, typename Rng>
+void addLink ( Tree & tree_, const N source_, const N target_, Rng & rng_ ) {
+    tree_.addArc ( source_, target_, tree_.data ( source_ ).take ( rng_ ) );
 }
 
 template<typename Tree, typename N>
@@ -76,21 +127,50 @@ template<typename Tree, typename N>
     return tree_[ source_ ].size ( );
 }
 
+template<typename Node, typename = void>
+struct has_next_sibling : std::false_type {};
+template<typename Node>
+struct has_next_sibling<Node, std::void_t<decltype ( std::declval<Node const &> ( ).next )>> : std::true_type {};
+
+// The n_-th child of source_, in the order of expansion (the out-list of fsntu runs newest first, it's walked from the
+// other end).
 template<typename Tree, typename N>
-[[nodiscard]] N selectChild ( const Tree & tree_, const N source_ ) noexcept {
-    const std::uint32_t n =
-        sax::uniform_int_distribution<std::uint32_t> ( 0, tree_.outArcNum ( source_ ) - 1 ) ( rng.instance ( ) );
-    if constexpr ( std::is_pointer<typename Tree::NodeID>::value ) { // ast.
-        return tree_.outArcs ( source_ )[ n ]->target;
+[[nodiscard]] N nthChild ( const Tree & tree_, const N source_, std::uint32_t n_ ) noexcept {
+    if constexpr ( not tree_access::has_arcs<Tree> ) { // fsnt, fsntu.
+        if constexpr ( not has_next_sibling<typename Tree::Node>::value ) // fsntu.
+            n_ = static_cast<std::uint32_t> ( tree_.arity ( source_ ) ) - 1u - n_;
+        typename Tree::const_out_iterator it{ tree_, source_ };
+        while ( n_-- )
+            ++it;
+        return it.id ( );
+    }
+    else if constexpr ( std::is_pointer<typename Tree::NodeID>::value ) { // ast.
+        return tree_.outArcs ( source_ )[ n_ ]->target;
     }
-    else { // fst.
+    else { // fst, fsth.
         typename Tree::const_out_iterator it = tree_.cbeginOut ( source_ );
-        std::advance ( it, n );
+        std::advance ( it, n_ );
         return it->target;
     }
 }
 
+template<typename Tree, typename N>
+[[nodiscard]] std::uint32_t childNum ( const Tree & tree_, const N source_ ) noexcept {
+    if constexpr ( tree_access::has_arcs<Tree> )
+        return static_cast<std::uint32_t> ( tree_.outArcNum ( source_ ) );
+    else
+        return static_cast<std::uint32_t> ( tree_.arity ( source_ ) );
+}
+
+template<typename Tree, typename N, typename Rng>
+[[nodiscard]] N selectChild ( const Tree & tree_, const N source_, Rng & rng_ ) noexcept {
+    return nthChild ( tree_, source_, rng_.bounded ( childNum ( tree_, source_ ) ) );
+}
+
 template<typename Tree, typename N>
 [[nodiscard]] bool hasChild ( const Tree & tree_, const N source_ ) noexcept {
-    return tree_.hasOutArc ( source_ );
+    if constexpr ( tree_access::has_arcs<Tree> )
+        return tree_.hasOutArc ( source_ );
+    else
+        return tree_.is_internal ( source_ );
 }
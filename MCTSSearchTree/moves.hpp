@@ -26,7 +26,6 @@
 #include <cassert>
 #include <cstdint>
 #include <cstdlib>
-#include <cstring>
 
 #include <random>
 #include <iostream>
@@ -34,12 +33,8 @@
 #include <cereal/cereal.hpp>
 #include <cereal/archives/binary.hpp>
 
-#include <sax/splitmix.hpp> // https://github.com/degski/Sax/blob/master/splitmix.hpp
-#include <sax/uniform_int_distribution.hpp>
 #include "types.hpp"
-#include <sax/singleton.hpp>
-
-extern sax::singleton<sax::splitmix64> rng;
+#include "batched_rng.hpp"
 
 template<typename T, std::size_t S>
 class Moves {
@@ -77,8 +72,9 @@ class Moves {
 
     void emplace_back ( value_type && m_ ) noexcept { m_moves[ m_size++ ] = std::move ( m_ ); }
 
-    [[nodiscard]] value_type random ( ) const noexcept {
-        return m_moves[ sax::uniform_int_distribution<std::ptrdiff_t> ( 0, m_size - 1 ) ( rng.instance ( ) ) ];
+    template<typename Rng>
+    [[nodiscard]] value_type random ( Rng & rng_ ) const noexcept {
+        return m_moves[ rng_.bounded ( static_cast<std::uint32_t> ( m_size ) ) ];
     }
 
     [[nodiscard]] bool find ( const value_type m_ ) const noexcept {
@@ -91,17 +87,16 @@ class Moves {
     }
 
     // Select a move, remove and return it.
-    [[nodiscard]] value_type take ( ) noexcept {
-        const Int i{ sax::uniform_int_distribution<Int>{ 0, --m_size }( rng.instance ( ) ) };
+    template<typename Rng>
+    [[nodiscard]] value_type take ( Rng & rng_ ) noexcept {
+        const Int i = static_cast<Int> ( rng_.bounded ( static_cast<std::uint32_t> ( m_size-- ) ) );
         const value_type v{ m_moves[ i ] };
         m_moves[ i ] = m_moves[ m_size ];
         return v;
     }
 
-    [[maybe_unused]] Moves & operator= ( const Moves & rhs_ ) noexcept {
-        std::memcpy ( this, &rhs_, sizeof ( Moves ) );
-        return *this;
-    }
+    // Defaulted, a member-wise copy of a trivial array, Moves stays trivially copyable (snapshots, checkpoints).
+    [[maybe_unused]] Moves & operator= ( const Moves & rhs_ ) noexcept = default;
 
     void remove ( const value_type m_ ) noexcept {
         if ( m_size < 2 and m_moves[ 0 ] == m_ ) {
@@ -66,6 +66,9 @@
     #pragma warning ( push )
     #pragma warning ( disable : 4244 )
 #else
+    #if defined ( __BMI2__ ) && defined ( __x86_64__ )
+        #include <immintrin.h>
+    #endif
     #define GNU 1
     #define MSVC 0
     #if defined ( __clang__ )
@@ -190,6 +193,42 @@ template<> struct double_width_integer<std::uint64_t> { using type = absl::uint1
 template<> struct double_width_integer<std::uint64_t> { using type = __uint128_t; };
 #endif
 
+// The high and the low half of the full product x * y, 64 bit lanes go to _umul128 (MSVC), mulx (BMI2), __uint128_t
+// (gcc/clang on 64 bit platforms), absl::uint128 or four 32 bit multiplies, in that order of preference.
+template<typename Type>
+[[ nodiscard ]] inline Type mul_hi_lo ( const Type x, const Type y, Type & hi ) NOEXCEPT {
+    if constexpr ( std::is_same<Type, std::uint64_t>::value ) {
+        #if MSVC and M64
+        return _umul128 ( x, y, &hi );
+        #elif GNU and M64 and defined ( __BMI2__ ) and defined ( __x86_64__ )
+        unsigned long long h;
+        const Type l = _mulx_u64 ( x, y, &h );
+        hi = h;
+        return l;
+        #elif GNU and M64
+        const __uint128_t m = __uint128_t ( x ) * y;
+        hi = Type ( m >> 64 );
+        return Type ( m );
+        #elif USE_ABSEIL
+        const absl::uint128 m = absl::uint128 ( x ) * y;
+        hi = absl::Uint128High64 ( m );
+        return absl::Uint128Low64 ( m );
+        #else
+        const std::uint64_t xl = x & 0xFFFF'FFFF, xh = x >> 32, yl = y & 0xFFFF'FFFF, yh = y >> 32;
+        const std::uint64_t ll = xl * yl, lh = xl * yh, hl = xh * yl, hh = xh * yh;
+        const std::uint64_t c = ( ll >> 32 ) + ( lh & 0xFFFF'FFFF ) + ( hl & 0xFFFF'FFFF );
+        hi = hh + ( lh >> 32 ) + ( hl >> 32 ) + ( c >> 32 );
+        return ( c << 32 ) | ( ll & 0xFFFF'FFFF );
+        #endif
+    }
+    else {
+        using double_width_type = typename double_width_integer<Type>::type;
+        const double_width_type m = double_width_type ( x ) * double_width_type ( y );
+        hi = Type ( m >> std::numeric_limits<Type>::digits );
+        return Type ( m );
+    }
+}
+
 template<typename IntType>
 using is_distribution_result_type =
 std::disjunction <
@@ -298,6 +337,32 @@ class uniform_int_distribution_fast : public detail::param_type<IntType, uniform
         }
     }
 
+    // Writes n values to out, the generator reference and the rejection threshold are set up once for the whole batch.
+    template<typename Gen, typename OutputIt>
+    OutputIt generate ( Gen & rng, OutputIt out, std::size_t n ) const NOEXCEPT {
+        generator_reference<Gen> rng_ref ( rng );
+        if ( 0 == pt::range ) {
+            for ( ; n; --n, ++out )
+                *out = static_cast< result_type > ( rng_ref ( ) );
+            return out;
+        }
+        if constexpr ( detail::br_lemire_oneill<range_type> ( ) ) {
+            const range_type t = ( 0 - pt::range ) % pt::range; // Once per batch, instead of once per value.
+            for ( ; n; --n, ++out ) {
+                range_type h, l = detail::mul_hi_lo<range_type> ( rng_ref ( ), pt::range, h );
+                while ( l < t ) {
+                    l = detail::mul_hi_lo<range_type> ( rng_ref ( ), pt::range, h );
+                }
+                *out = result_type ( h ) + pt::min;
+            }
+        }
+        if constexpr ( detail::br_bitmask<range_type> ( ) ) {
+            for ( ; n; --n, ++out )
+                *out = bounded_range_bitmask ( rng_ref ) + pt::min;
+        }
+        return out;
+    }
+
     [[ nodiscard ]] param_type param ( ) const NOEXCEPT {
         return *this;
     }
@@ -321,87 +386,35 @@ class uniform_int_distribution_fast : public detail::param_type<IntType, uniform
 
     template<typename Rng>
     result_type bounded_range_lemire ( Rng & rng ) const NOEXCEPT {
-        #if MSVC and M64
-        if constexpr ( std::is_same<range_type, std::uint64_t>::value ) {
-            const range_type t = ( 0 - pt::range ) % pt::range;
-            range_type x = rng ( );
-            range_type h, l = _umul128 ( x, pt::range, &h );
-            while ( l < t ) {
-                x = rng ( );
-                l = _umul128 ( x, pt::range, &h );
-            };
-            return result_type ( h );
-        }
-        else { // pt::range is of type std::uint32_t.
-        #endif
-            using double_width_unsigned_result_type = typename detail::double_width_integer<range_type>::type;
-            const range_type t = ( 0 - pt::range ) % pt::range;
-            range_type x = rng ( );
-            double_width_unsigned_result_type m = double_width_unsigned_result_type ( x ) * double_width_unsigned_result_type ( pt::range );
-            range_type l = range_type ( m );
-            while ( l < t ) {
-                x = rng ( );
-                m = double_width_unsigned_result_type ( x ) * double_width_unsigned_result_type ( pt::range );
-                l = range_type ( m );
-            };
-            return result_type ( m >> std::numeric_limits<range_type>::digits );
-        #if MSVC and M64
-        }
-        #endif
+        const range_type t = ( 0 - pt::range ) % pt::range;
+        range_type h, l = detail::mul_hi_lo<range_type> ( rng ( ), pt::range, h );
+        while ( l < t ) {
+            l = detail::mul_hi_lo<range_type> ( rng ( ), pt::range, h );
+        };
+        return result_type ( h );
     }
 
     template<typename Rng>
     result_type bounded_range_lemire_oneill ( Rng & rng ) const NOEXCEPT {
-        #if MSVC and M64
-        if constexpr ( std::is_same<range_type, std::uint64_t>::value ) {
-            range_type x = rng ( );
-            if ( pt::range >= range_mask ( ) ) {
-                do {
-                    x = rng ( );
-                } while ( x >= pt::range );
-                return result_type ( x );
-            }
-            range_type h, l = _umul128 ( x, pt::range, &h );
-            if ( l < pt::range ) {
-                range_type t = ( 0 - pt::range );
-                t -= pt::range;
-                if ( t >= pt::range ) {
-                    t %= pt::range;
-                }
-                while ( l < t ) {
-                    l = _umul128 ( rng ( ), pt::range, &h );
-                }
-            }
-            return result_type ( h );
+        range_type x = rng ( );
+        if ( pt::range >= range_mask ( ) ) {
+            do {
+                x = rng ( );
+            } while ( x >= pt::range );
+            return result_type ( x );
         }
-        else {
-        #endif
-            using double_width_range_type = typename detail::double_width_integer<range_type>::type;
-            range_type x = rng ( );
-            if ( pt::range >= range_mask ( ) ) {
-                do {
-                    x = rng ( );
-                } while ( x >= pt::range );
-                return result_type ( x );
+        range_type h, l = detail::mul_hi_lo<range_type> ( x, pt::range, h );
+        if ( l < pt::range ) {
+            range_type t = ( 0 - pt::range );
+            t -= pt::range;
+            if ( t >= pt::range ) {
+                t %= pt::range;
             }
-            double_width_range_type m = double_width_range_type ( x ) * double_width_range_type ( pt::range );
-            range_type l = range_type ( m );
-            if ( l < pt::range ) {
-                range_type t = ( 0 - pt::range );
-                t -= pt::range;
-                if ( t >= pt::range ) {
-                    t %= pt::range;
-                }
-                while ( l < t ) {
-                    x = rng ( );
-                    m = double_width_range_type ( x ) * double_width_range_type ( pt::range );
-                    l = range_type ( m );
-                }
+            while ( l < t ) {
+                l = detail::mul_hi_lo<range_type> ( rng ( ), pt::range, h );
             }
-            return result_type ( m >> std::numeric_limits<range_type>::digits );
-        #if MSVC and M64
         }
-        #endif
+        return result_type ( h );
     }
 };
 } // namespace ext
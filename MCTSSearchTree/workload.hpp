@@ -0,0 +1,220 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "types.hpp"
+#include "tree_access.hpp"
+#include "batched_rng.hpp"
+#include "mcts_emu.hpp"
+
+// The shape of the emulated search, all probabilities per playout, the defaults are the shape of a PUCT search with
+// progressive widening on a game with a branching factor of 8 to 64 and 80 plies.
+struct WorkloadConfig {
+    std::uint64_t seed = 0x5EED'0000'0000'0035;
+    Int min_moves = 8, max_moves = 64; // The branching factor of a new node is drawn uniformly from [ min_moves, max_moves ].
+    Int game_length = 80;              // Nodes at this depth are terminal (have no moves).
+    // Selection: the k-th child (in the order of expansion) is selected with a probability proportional to
+    // 1 / ( k + 1 ) ^ focus, i.e. the first (best) children get most of the visits, as with PUCT, and the visit counts
+    // follow a power law. 0 selects uniformly.
+    double focus = 1.2;
+    // Progressive widening: a node gets a new child as long as it has less than widen_k * visits ^ widen_alpha of them.
+    double widen_k = 1.0, widen_alpha = 0.5;
+    // fsth only: the probability that an expansion links to an existing node one ply down, instead of adding a node.
+    double transposition_rate = 0.0;
+};
+
+// Grows a flat tree (fst, fsth, fsnt, fsntu) with playouts shaped by a WorkloadConfig. A generator with the same config
+// grows the same tree, the seed being the only source of randomness.
+class WorkloadGenerator {
+
+    WorkloadConfig m_config;
+    ext::buffered_rng m_rng;
+    std::vector<double> m_cdf; // m_cdf[ n * ( n - 1 ) / 2 + k ], the selection cdf of a node with n children.
+    std::vector<std::uint32_t> m_visits;   // By node.
+    std::vector<std::vector<std::uint64_t>> m_by_depth; // The nodes by depth, the candidates for transpositions (fsth).
+    std::vector<std::uint32_t> m_widen;       // The number of children allowed by visits, ceil ( widen_k * v ^ widen_alpha ).
+
+    [[nodiscard]] double uniform ( ) noexcept { return ( m_rng ( ) >> 11 ) * 0x1.0p-53; }
+
+    [[nodiscard]] std::uint32_t selectRank ( const std::uint32_t n_ ) noexcept {
+        if ( n_ > max_children or m_config.focus == 0.0 )
+            return m_rng.bounded ( n_ );
+        const double * const cdf = m_cdf.data ( ) + n_ * ( n_ - 1 ) / 2;
+        return static_cast<std::uint32_t> ( std::upper_bound ( cdf, cdf + n_ - 1, uniform ( ) ) - cdf );
+    }
+
+    [[nodiscard]] Int moves ( const Int depth_ ) noexcept {
+        if ( depth_ >= m_config.game_length )
+            return 0;
+        return m_config.min_moves +
+               static_cast<Int> ( m_rng.bounded ( static_cast<std::uint32_t> ( m_config.max_moves - m_config.min_moves + 1 ) ) );
+    }
+
+    [[nodiscard]] std::uint32_t widen ( const std::uint32_t visits_ ) {
+        auto const limit = [ this ] ( std::size_t v ) {
+            return static_cast<std::uint32_t> ( std::ceil ( m_config.widen_k * std::pow ( double ( v ), m_config.widen_alpha ) ) );
+        };
+        if ( visits_ >= widen_table_size )
+            return limit ( visits_ );
+        while ( m_widen.size ( ) <= visits_ )
+            m_widen.push_back ( limit ( m_widen.size ( ) ) );
+        return m_widen[ visits_ ];
+    }
+
+    template<typename Tree>
+    [[nodiscard]] std::uint32_t & visits ( const typename Tree::NodeID node_ ) {
+        if ( static_cast<std::size_t> ( node_.value ) >= m_visits.size ( ) )
+            m_visits.resize ( 2 * static_cast<std::size_t> ( node_.value ) + 1, 0u );
+        return m_visits[ node_.value ];
+    }
+
+    public:
+    static constexpr std::uint32_t max_children     = 64;        // The selection cdf is tabled up to this number of children.
+    static constexpr std::uint32_t widen_table_size = 1u << 16; // And widening up to this number of visits.
+
+    explicit WorkloadGenerator ( WorkloadConfig const & config_ = WorkloadConfig{ } ) :
+        m_config{ config_ }, m_rng{ config_.seed } {
+        assert ( 0 < m_config.min_moves and m_config.min_moves <= m_config.max_moves );
+        assert ( m_config.max_moves <= MovesType{ }.capacity ( ) );
+        m_cdf.reserve ( max_children * ( max_children + 1 ) / 2 );
+        for ( std::uint32_t n = 1; n <= max_children; ++n ) {
+            double sum = 0.0;
+            for ( std::uint32_t k = 0; k < n; ++k )
+                sum += std::pow ( k + 1.0, -m_config.focus );
+            double cum = 0.0;
+            for ( std::uint32_t k = 0; k < n; ++k )
+                m_cdf.push_back ( ( cum += std::pow ( k + 1.0, -m_config.focus ) ) / sum );
+        }
+    }
+
+    [[nodiscard]] WorkloadConfig const & config ( ) const noexcept { return m_config; }
+
+    // The number of playouts that passed through node_ of the tree grown last, f.e. the key of lyt::relayout.
+    template<typename NodeID>
+    [[nodiscard]] std::uint32_t visitCount ( const NodeID node_ ) const noexcept {
+        return static_cast<std::size_t> ( node_.value ) < m_visits.size ( ) ? m_visits[ node_.value ] : 0u;
+    }
+
+    // After a prune (gc::prune) of the tree grown last, move the visit counts to the new ids, remap_ is the new id by old
+    // id (invalid if pruned), as prune returns it. The ids are remapped downward, in order.
+    template<typename NodeID>
+    void remap ( std::vector<NodeID> const & remap_ ) {
+        std::size_t size = 0;
+        for ( std::size_t n = 1; n < remap_.size ( ) and n < m_visits.size ( ); ++n )
+            if ( NodeID::invalid ( ) != remap_[ n ] ) {
+                assert ( static_cast<std::size_t> ( remap_[ n ].value ) <= n );
+                m_visits[ remap_[ n ].value ] = m_visits[ n ];
+                size                          = static_cast<std::size_t> ( remap_[ n ].value ) + 1;
+            }
+        std::fill ( std::begin ( m_visits ) + std::min ( size, m_visits.size ( ) ), std::end ( m_visits ), 0u );
+    }
+
+    // A tree holding just the root, call this first, it resets the generator.
+    template<typename Tree>
+    [[nodiscard]] Tree makeTree ( ) {
+        static_assert ( not std::is_pointer<typename Tree::NodeID>::value, "the workload generator drives the flat trees" );
+        m_rng.seed ( m_config.seed );
+        m_visits.clear ( );
+        m_by_depth.clear ( );
+        return Tree ( getMoves ( m_rng, moves ( 0 ) ) );
+    }
+
+    // One playout: descend, selecting by rank, until a node that may widen, or a terminal node, is reached. Returns the
+    // node that was added (or linked to), or NodeID::invalid ( ) if the playout ended in a terminal node.
+    template<typename Tree>
+    typename Tree::NodeID playout ( Tree & tree_ ) {
+        using NodeID = typename Tree::NodeID;
+        NodeID node  = tree_.root_node;
+        Int depth    = 0;
+        while ( true ) {
+            const std::uint32_t v = ++visits<Tree> ( node );
+            const std::uint32_t n = childNum ( tree_, node );
+            if ( hasMoves ( tree_, node ) and n < widen ( v ) )
+                return expand ( tree_, node, depth + 1 );
+            if ( not n )
+                return NodeID::invalid ( );
+            node = nthChild ( tree_, node, selectRank ( n ) );
+            ++depth;
+        }
+    }
+
+    // Playouts until the tree holds nodes_ nodes (or the game is exhausted), returns the number of playouts.
+    template<typename Tree>
+    std::uint64_t grow ( Tree & tree_, const std::uint64_t nodes_ ) {
+        std::uint64_t playouts = 0, idle = 0;
+        while ( static_cast<std::uint64_t> ( tree_access::nodes ( tree_ ).size ( ) - 1 ) < nodes_ and idle < 1'000'000 ) {
+            idle = Tree::NodeID::invalid ( ) == playout ( tree_ ) ? idle + 1 : 0;
+            ++playouts;
+        }
+        return playouts;
+    }
+
+    private:
+    template<typename Tree>
+    typename Tree::NodeID expand ( Tree & tree_, const typename Tree::NodeID source_, const Int depth_ ) {
+        using NodeID = typename Tree::NodeID;
+        if constexpr ( tree_access::has_transpositions<Tree> ) { // fsth.
+            if ( depth_ < static_cast<Int> ( m_by_depth.size ( ) ) and m_by_depth[ depth_ ].size ( ) and
+                 uniform ( ) < m_config.transposition_rate ) {
+                std::vector<std::uint64_t> const & candidates = m_by_depth[ depth_ ];
+                const NodeID target{ candidates[ m_rng.bounded ( static_cast<std::uint32_t> ( candidates.size ( ) ) ) ] };
+                bool linked         = false;
+                for ( auto it = tree_.cbeginOut ( source_ ); it.is_valid ( ) and not linked; ++it )
+                    linked = it->target == target;
+                if ( not linked ) {
+                    tree_.addArc ( source_, target, tree_[ source_ ].take ( m_rng ) );
+                    return target;
+                }
+            }
+            using Hash          = std::remove_const_t<decltype ( Tree::root_hash )>;
+            const NodeID target = tree_.addNode ( static_cast<Hash> ( m_rng ( ) ), getMoves ( m_rng, moves ( depth_ ) ) );
+            tree_.addArc ( source_, target, tree_[ source_ ].take ( m_rng ) );
+            if ( depth_ >= static_cast<Int> ( m_by_depth.size ( ) ) )
+                m_by_depth.resize ( depth_ + 1 );
+            m_by_depth[ depth_ ].push_back ( target.value );
+            return target;
+        }
+        else if constexpr ( tree_access::has_arcs<Tree> ) { // fst.
+            const NodeID target = tree_.addNode ( getMoves ( m_rng, moves ( depth_ ) ) );
+            tree_.addArc ( source_, target, tree_[ source_ ].take ( m_rng ) );
+            return target;
+        }
+        else { // fsnt, fsntu.
+            [[maybe_unused]] const MoveType move = tree_[ source_ ].take ( m_rng );
+            return tree_.add_node ( source_, getMoves ( m_rng, moves ( depth_ ) ) );
+        }
+    }
+
+};
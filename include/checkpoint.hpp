@@ -0,0 +1,407 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "types.hpp"
+#include "tree_access.hpp"
+
+// Append-only checkpoints of a growing tree. As the trees only grow, a checkpoint
+// consists of the arcs and nodes added since the previous checkpoint, plus patches
+// of the older nodes that had their link fields updated in the meantime (the nodes
+// the new elements were appended to) and of the touched older nodes and arcs. The
+// links from the old tails of the lists to the new arcs are not stored, the loader
+// relinks them, the old tail of a list being the tail of its node as persisted. The
+// file is a header followed by a sequence of segments, the first (and any segment
+// written by reset ( )) being a full image of the tree:
+//
+//     [ header | segment | segment | ... ]
+//
+//     segment: [ segment header | new arcs | new nodes | arc patches | node patches ]
+//
+// Patches carry the complete node (arc), i.e. including the data, changes to the data
+// of nodes that did not get a new child are only recorded after a touch ( node ), of
+// arcs after a touch ( arc ). A re-root, a prune or a replacement of the tree (see
+// Generation) is detected and answered by a full image.
+
+namespace ckpt {
+
+inline constexpr std::uint64_t checkpoint_magic   = 0x54504B435354434Dull; // "MCTSCKPT".
+inline constexpr std::uint64_t segment_magic      = 0x4D4745535354434Dull; // "MCTSSEGM".
+inline constexpr std::uint32_t checkpoint_version = 2u;
+
+struct CheckpointHeader {
+    std::uint64_t magic;
+    std::uint32_t version, id_size;    // sizeof ( NodeID ), the id type of the tree.
+    std::uint32_t arc_size, node_size; // sizeof ( Arc ) [0 for fsnt and fsntu], sizeof ( Node ).
+};
+
+struct SegmentHeader {
+    std::uint64_t magic;
+    std::uint64_t arc_begin, arc_end;   // New arcs [ arc_begin, arc_end ), arc_begin == 0 for a full image.
+    std::uint64_t node_begin, node_end; // New nodes [ node_begin, node_end ), node_begin == 0 for a full image.
+    std::uint64_t arc_patch_num, node_patch_num;
+    std::int64_t root_arc, root_node;
+};
+
+namespace detail {
+
+template<typename Tree>
+[[nodiscard]] constexpr std::uint32_t arc_size_of ( ) noexcept {
+    if constexpr ( tree_access::has_arcs<Tree> )
+        return sizeof ( typename Tree::Arc );
+    else
+        return 0u;
+}
+
+template<typename Arc>
+struct ArcPatch {
+    std::uint64_t index;
+    Arc arc;
+};
+
+template<typename Node>
+struct NodePatch {
+    std::uint64_t index;
+    Node node;
+};
+
+template<typename T>
+void write ( std::ostream & out_, T const * data_, std::size_t const n_ ) {
+    out_.write ( reinterpret_cast<char const *> ( data_ ), static_cast<std::streamsize> ( n_ * sizeof ( T ) ) );
+}
+
+template<typename T>
+[[nodiscard]] bool read ( std::istream & in_, T * data_, std::size_t const n_ ) {
+    in_.read ( reinterpret_cast<char *> ( data_ ), static_cast<std::streamsize> ( n_ * sizeof ( T ) ) );
+    return static_cast<std::size_t> ( in_.gcount ( ) ) == n_ * sizeof ( T );
+}
+
+// Takes count_ elements of size_ bytes off the bytes left_ in the file, false if they are not all there (a torn or a
+// corrupt segment), such that a segment header cannot size a vector beyond the file.
+[[nodiscard]] inline bool take ( std::uint64_t & left_, std::uint64_t const count_, std::size_t const size_ ) noexcept {
+    if ( count_ > left_ / size_ )
+        return false;
+    left_ -= count_ * size_;
+    return true;
+}
+
+// Replace the elements from begin_ onwards by new_.
+template<typename Vector, typename New>
+void splice ( Vector & vector_, std::size_t const begin_, New & new_ ) {
+    vector_.resize ( begin_ );
+    for ( auto & e : new_ )
+        vector_.emplace_back ( std::move ( e ) );
+}
+
+// The elements are written and read as memory images.
+template<typename Tree>
+constexpr void check_layout ( ) noexcept {
+    static_assert ( std::is_trivially_copyable<typename Tree::Node>::value, "node data should be trivially copyable" );
+    if constexpr ( tree_access::has_arcs<Tree> )
+        static_assert ( std::is_trivially_copyable<typename Tree::Arc>::value, "arc data should be trivially copyable" );
+}
+
+} // namespace detail
+
+template<typename Tree>
+class CheckpointWriter {
+
+    public:
+    using NodeID = typename Tree::NodeID;
+
+    // Open (truncate) path_ and write a full image of tree_.
+    CheckpointWriter ( Tree const & tree_, std::filesystem::path const & path_ ) :
+        m_tree{ tree_ }, m_out{ path_, std::ios::binary | std::ios::trunc } {
+        detail::check_layout<Tree> ( );
+        if ( not m_out )
+            throw std::runtime_error ( "CheckpointWriter: cannot open " + path_.string ( ) );
+        CheckpointHeader const header{ checkpoint_magic, checkpoint_version, sizeof ( NodeID ), detail::arc_size_of<Tree> ( ),
+                                       sizeof ( typename Tree::Node ) };
+        detail::write ( m_out, &header, 1u );
+        reset ( );
+    }
+
+    // Record a change of the data of node_ (changes due to added children are tracked).
+    void touch ( NodeID const node_ ) { m_touched.push_back ( node_ ); }
+    // Record a change of the data of arc_ (fst, fsth).
+    template<typename T = Tree, typename = std::enable_if_t<tree_access::has_arcs<T>>>
+    void touch ( typename T::ArcID const arc_ ) {
+        m_touched_arcs.push_back ( arc_ );
+    }
+
+    // Append the arcs and nodes added since the last checkpoint, plus the patches,
+    // returns the number of bytes written.
+    [[maybe_unused]] std::size_t checkpoint ( ) {
+        auto const & nodes = tree_access::nodes ( m_tree );
+        if ( stale ( ) )
+            return reset ( ); // The tree was re-rooted, pruned or replaced.
+        if constexpr ( tree_access::has_arcs<Tree> ) {
+            auto const & arcs = tree_access::arcs ( m_tree );
+            for ( std::size_t a = m_arcs_size; a < arcs.size ( ); ++a ) { // The old ends got a new head, tail or size.
+                NodeID const source = arcs[ a ].source, target = arcs[ a ].target;
+                if ( NodeID::invalid ( ) != source and static_cast<std::size_t> ( source.value ) < m_nodes_size )
+                    m_touched.push_back ( source );
+                if ( NodeID::invalid ( ) != target and static_cast<std::size_t> ( target.value ) < m_nodes_size )
+                    m_touched.push_back ( target );
+            }
+        }
+        else {
+            for ( std::size_t n = m_nodes_size; n < nodes.size ( ); ++n ) {
+                NodeID const up = nodes[ n ].up;
+                if ( NodeID::invalid ( ) != up and static_cast<std::size_t> ( up.value ) < m_nodes_size ) {
+                    m_touched.push_back ( up );
+                    // The old last child got a new next (fsnt only).
+                    if constexpr ( has_next<typename Tree::Node>::value ) {
+                        NodeID const prev = nodes[ n ].prev;
+                        if ( NodeID::invalid ( ) != prev and static_cast<std::size_t> ( prev.value ) < m_nodes_size )
+                            m_touched.push_back ( prev );
+                    }
+                }
+            }
+        }
+        return write_segment ( );
+    }
+
+    // Write a full image of the tree, required after the tree was re-rooted or otherwise
+    // rebuilt, returns the number of bytes written.
+    [[maybe_unused]] std::size_t reset ( ) {
+        m_arcs_size = m_nodes_size = 0u;
+        m_touched.clear ( );
+        m_touched_arcs.clear ( );
+        return write_segment ( );
+    }
+
+    private:
+    template<typename T, typename = void>
+    struct arc_id {
+        using type = typename T::NodeID;
+    };
+    template<typename T>
+    struct arc_id<T, std::void_t<typename T::ArcID>> {
+        using type = typename T::ArcID;
+    };
+
+    template<typename T, typename = void>
+    struct has_next : std::false_type {};
+    template<typename T>
+    struct has_next<T, std::void_t<decltype ( std::declval<T> ( ).next )>> : std::true_type {};
+
+    template<typename T, typename = void>
+    struct arc_type {
+        using type = typename T::Node;
+    };
+    template<typename T>
+    struct arc_type<T, std::void_t<typename T::ArcID>> {
+        using type = typename T::Arc;
+    };
+
+    using ArcID     = typename arc_id<Tree>::type;
+    using ArcPatch  = detail::ArcPatch<typename arc_type<Tree>::type>;
+    using NodePatch = detail::NodePatch<typename Tree::Node>;
+
+    // The ids persisted so far went stale, the tree was rebuilt since the last segment, or it shrunk.
+    [[nodiscard]] bool stale ( ) const noexcept {
+        if ( m_tree.generation ( ) != m_generation or m_tree.root_node != m_root_node or
+             tree_access::nodes ( m_tree ).size ( ) < m_nodes_size )
+            return true;
+        if constexpr ( tree_access::has_arcs<Tree> )
+            return m_tree.root_arc != m_root_arc or tree_access::arcs ( m_tree ).size ( ) < m_arcs_size;
+        else
+            return false;
+    }
+
+    std::size_t write_segment ( ) {
+        auto const & nodes = tree_access::nodes ( m_tree );
+        std::sort ( m_touched.begin ( ), m_touched.end ( ),
+                    [] ( NodeID const a_, NodeID const b_ ) { return a_.value < b_.value; } );
+        m_touched.erase ( std::unique ( m_touched.begin ( ), m_touched.end ( ) ), m_touched.end ( ) );
+        // Of the touched arcs, the old ones, the new ones are written in full anyway.
+        std::sort ( m_touched_arcs.begin ( ), m_touched_arcs.end ( ),
+                    [] ( ArcID const a_, ArcID const b_ ) { return a_.value < b_.value; } );
+        m_touched_arcs.erase ( std::unique ( m_touched_arcs.begin ( ), m_touched_arcs.end ( ) ), m_touched_arcs.end ( ) );
+        m_touched_arcs.erase ( std::lower_bound ( m_touched_arcs.begin ( ), m_touched_arcs.end ( ), m_arcs_size,
+                                                  [] ( ArcID const a_, std::size_t const size_ ) {
+                                                      return static_cast<std::size_t> ( a_.value ) < size_;
+                                                  } ),
+                               m_touched_arcs.end ( ) );
+        SegmentHeader header{ };
+        header.magic      = segment_magic;
+        header.node_begin = m_nodes_size;
+        header.node_end   = nodes.size ( );
+        header.root_node  = m_tree.root_node.value;
+        if constexpr ( tree_access::has_arcs<Tree> ) {
+            header.arc_begin     = m_arcs_size;
+            header.arc_end       = tree_access::arcs ( m_tree ).size ( );
+            header.arc_patch_num = m_touched_arcs.size ( );
+            header.root_arc      = m_tree.root_arc.value;
+            m_root_arc           = m_tree.root_arc;
+        }
+        header.node_patch_num = m_touched.size ( );
+        detail::write ( m_out, &header, 1u );
+        if constexpr ( tree_access::has_arcs<Tree> ) {
+            auto const & arcs = tree_access::arcs ( m_tree );
+            detail::write ( m_out, arcs.data ( ) + m_arcs_size, arcs.size ( ) - m_arcs_size );
+            m_arcs_size = arcs.size ( );
+        }
+        detail::write ( m_out, nodes.data ( ) + m_nodes_size, nodes.size ( ) - m_nodes_size );
+        m_nodes_size = nodes.size ( );
+        if constexpr ( tree_access::has_arcs<Tree> ) {
+            auto const & arcs = tree_access::arcs ( m_tree );
+            for ( ArcID const a : m_touched_arcs ) {
+                ArcPatch const patch{ static_cast<std::uint64_t> ( a.value ), arcs[ a.value ] };
+                detail::write ( m_out, &patch, 1u );
+            }
+        }
+        for ( NodeID const n : m_touched ) {
+            NodePatch const patch{ static_cast<std::uint64_t> ( n.value ), nodes[ n.value ] };
+            detail::write ( m_out, &patch, 1u );
+        }
+        m_out.flush ( );
+        if ( not m_out )
+            throw std::runtime_error ( "CheckpointWriter: write failed" );
+        std::size_t const bytes = sizeof ( SegmentHeader ) +
+                                  ( header.arc_end - header.arc_begin ) * detail::arc_size_of<Tree> ( ) +
+                                  ( header.node_end - header.node_begin ) * sizeof ( typename Tree::Node ) +
+                                  m_touched_arcs.size ( ) * sizeof ( ArcPatch ) + m_touched.size ( ) * sizeof ( NodePatch );
+        m_touched.clear ( );
+        m_touched_arcs.clear ( );
+        m_generation = m_tree.generation ( );
+        m_root_node  = m_tree.root_node;
+        return bytes;
+    }
+
+    Tree const & m_tree;
+    std::ofstream m_out;
+    std::size_t m_arcs_size = 0u, m_nodes_size = 0u; // Persisted so far.
+    std::uint64_t m_generation = 0u;                  // Of the tree, at the last segment, with its root.
+    NodeID m_root_node;
+    ArcID m_root_arc;
+    std::vector<NodeID> m_touched;
+    std::vector<ArcID> m_touched_arcs;
+};
+
+// Replay the segments of a checkpoint file, a trailing incomplete segment (the process
+// died while writing it) is ignored.
+template<typename Tree>
+[[nodiscard]] Tree loadCheckpoint ( std::filesystem::path const & path_ ) {
+    using Node   = typename Tree::Node;
+    using NodeID = typename Tree::NodeID;
+    detail::check_layout<Tree> ( );
+    std::ifstream in ( path_, std::ios::binary );
+    if ( not in )
+        throw std::runtime_error ( "loadCheckpoint: cannot open " + path_.string ( ) );
+    CheckpointHeader header;
+    if ( not detail::read ( in, &header, 1u ) or checkpoint_magic != header.magic or checkpoint_version != header.version )
+        throw std::runtime_error ( "loadCheckpoint: not a checkpoint" );
+    if ( sizeof ( NodeID ) != header.id_size or detail::arc_size_of<Tree> ( ) != header.arc_size or
+         sizeof ( Node ) != header.node_size )
+        throw std::runtime_error ( "loadCheckpoint: checkpoint layout does not match the tree type" );
+    std::uint64_t const file_size = std::filesystem::file_size ( path_ );
+    Tree tree;
+    auto & nodes = tree_access::nodes ( tree );
+    SegmentHeader segment;
+    while ( detail::read ( in, &segment, 1u ) and segment_magic == segment.magic ) {
+        if ( segment.node_begin > nodes.size ( ) or segment.node_end < segment.node_begin )
+            throw std::runtime_error ( "loadCheckpoint: corrupt segment" );
+        std::uint64_t left = file_size - static_cast<std::uint64_t> ( in.tellg ( ) );
+        if ( not detail::take ( left, segment.node_end - segment.node_begin, sizeof ( Node ) ) or
+             not detail::take ( left, segment.node_patch_num, sizeof ( detail::NodePatch<Node> ) ) )
+            break;
+        // Read the complete segment before applying it.
+        std::vector<Node> new_nodes ( segment.node_end - segment.node_begin );
+        std::vector<detail::NodePatch<Node>> node_patches ( segment.node_patch_num );
+        if constexpr ( tree_access::has_arcs<Tree> ) {
+            using ArcID = typename Tree::ArcID;
+            auto & arcs = tree_access::arcs ( tree );
+            if ( segment.arc_begin > arcs.size ( ) or segment.arc_end < segment.arc_begin )
+                throw std::runtime_error ( "loadCheckpoint: corrupt segment" );
+            if ( not detail::take ( left, segment.arc_end - segment.arc_begin, sizeof ( typename Tree::Arc ) ) or
+                 not detail::take ( left, segment.arc_patch_num, sizeof ( detail::ArcPatch<typename Tree::Arc> ) ) )
+                break;
+            std::vector<typename Tree::Arc> new_arcs ( segment.arc_end - segment.arc_begin );
+            std::vector<detail::ArcPatch<typename Tree::Arc>> arc_patches ( segment.arc_patch_num );
+            if ( not detail::read ( in, new_arcs.data ( ), new_arcs.size ( ) ) or
+                 not detail::read ( in, new_nodes.data ( ), new_nodes.size ( ) ) or
+                 not detail::read ( in, arc_patches.data ( ), arc_patches.size ( ) ) or
+                 not detail::read ( in, node_patches.data ( ), node_patches.size ( ) ) )
+                break;
+            detail::splice ( arcs, segment.arc_begin, new_arcs );
+            // Link the old tails (of the old nodes, as persisted) to the first new arc of their lists, a tail is then
+            // the new arc, the later new arcs of the list are linked already (the node patch follows).
+            auto const relink = [ & ] ( ArcID & tail_, std::size_t const arc_, auto const next_ ) {
+                if ( ArcID::invalid ( ) != tail_ and static_cast<std::uint64_t> ( tail_.value ) < segment.arc_begin )
+                    arcs[ tail_.value ].*next_ = ArcID{ arc_ };
+                tail_ = ArcID{ arc_ };
+            };
+            for ( std::size_t a = segment.arc_begin; a < arcs.size ( ); ++a ) {
+                NodeID const source = arcs[ a ].source, target = arcs[ a ].target;
+                if ( NodeID::invalid ( ) != source and static_cast<std::uint64_t> ( source.value ) < segment.node_begin )
+                    relink ( nodes[ source.value ].tail_out, a, &Tree::Arc::next_out );
+                if constexpr ( tree_access::has_next_in<typename Tree::Arc> ) // Not in a tree (Links::tree).
+                    if ( NodeID::invalid ( ) != target and static_cast<std::uint64_t> ( target.value ) < segment.node_begin )
+                        relink ( nodes[ target.value ].tail_in, a, &Tree::Arc::next_in );
+            }
+            for ( auto const & p : arc_patches ) { // The elements are memory images (see CheckpointWriter).
+                if ( not p.index or p.index >= arcs.size ( ) )
+                    throw std::runtime_error ( "loadCheckpoint: corrupt segment" );
+                std::memcpy ( static_cast<void *> ( arcs.data ( ) + p.index ), &p.arc, sizeof ( typename Tree::Arc ) );
+            }
+            tree.root_arc = ArcID{ segment.root_arc };
+        }
+        else {
+            if ( not detail::read ( in, new_nodes.data ( ), new_nodes.size ( ) ) or
+                 not detail::read ( in, node_patches.data ( ), node_patches.size ( ) ) )
+                break;
+        }
+        detail::splice ( nodes, segment.node_begin, new_nodes );
+        for ( auto const & p : node_patches ) { // The elements are memory images (see CheckpointWriter).
+            if ( not p.index or p.index >= nodes.size ( ) )
+                throw std::runtime_error ( "loadCheckpoint: corrupt segment" );
+            std::memcpy ( static_cast<void *> ( nodes.data ( ) + p.index ), &p.node, sizeof ( Node ) );
+        }
+        tree.root_node = NodeID{ segment.root_node };
+    }
+    if constexpr ( tree_access::has_transpositions<Tree> ) {
+        auto & trans = tree_access::transpositions ( tree );
+        trans.clear ( );
+        for ( std::size_t n = 1u; n < nodes.size ( ); ++n )
+            trans.emplace ( nodes[ n ].hash, NodeID{ n } );
+    }
+    return tree;
+}
+
+} // namespace ckpt
@@ -0,0 +1,243 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+#include "tree_access.hpp"
+
+// Unrolled child lists, an alternative to the out-lists of the trees (next_out in fst and fsth, next and prev in fsnt
+// and fsntu), which cost a dependent load per child. The ids of the children of a node are kept in blocks of one
+// cache line (14 ids of 32 bits, 30 of 16 bits), the blocks of a node are linked and come from a per-tree block arena.
+// Iterating the children of a wide node touches a few cache lines, with independent loads within a block, appending a
+// child is O ( 1 ), as with the out-lists.
+//
+// The blocks hold the arc ids (fst, fsth) or node ids (fsnt, fsntu) of the children, in the order of appending, and
+// are kept next to a tree, f.e.:
+//
+//     cbl::ChildBlocksOf<Tree> blocks = cbl::ChildBlocksOf<Tree>::of ( tree );
+//     blocks.append ( node, tree.addArc ( node, tree.addNode ( ... ) ) );
+//     blocks.forEach ( node, [ & ] ( Tree::ArcID const arc_ ) { ... } );
+
+namespace cbl {
+
+inline constexpr std::size_t block_size = 64u;
+
+namespace detail {
+
+template<typename ID>
+struct alignas ( block_size ) Block {
+
+    using value_type = typename ID::value_type;
+
+    static constexpr std::size_t capacity = ( block_size - 2 * sizeof ( value_type ) ) / sizeof ( value_type );
+
+    value_type size = 0, next = 0; // The index of the next block, 0 (the admin block) ends the list.
+    ID ids[ capacity ];
+};
+
+template<typename Node, typename = void>
+struct has_next : std::false_type {};
+template<typename Node>
+struct has_next<Node, std::void_t<decltype ( std::declval<Node const &> ( ).next )>> : std::true_type {};
+
+template<typename Tree, typename = void>
+struct child_id {
+    using type = typename Tree::NodeID;
+};
+template<typename Tree>
+struct child_id<Tree, std::void_t<typename Tree::ArcID>> {
+    using type = typename Tree::ArcID;
+};
+
+} // namespace detail
+
+template<typename ParentID, typename ChildID, template<typename> typename Allocator = std::allocator>
+class ChildBlocks {
+
+    public:
+    using Block      = detail::Block<ChildID>;
+    using value_type = typename ChildID::value_type;
+
+    static_assert ( sizeof ( Block ) == block_size, "a block should fill one cache line" );
+
+    private:
+    struct List {
+        value_type head = 0, tail = 0, size = 0;
+    };
+
+    std::vector<Block, Allocator<Block>> m_blocks; // Block 0 is the admin block.
+    std::vector<List> m_lists;                     // By parent.
+
+    [[nodiscard]] List const * list ( ParentID const parent_ ) const noexcept {
+        return static_cast<std::size_t> ( parent_.value ) < m_lists.size ( ) ? m_lists.data ( ) + parent_.value : nullptr;
+    }
+
+    public:
+    ChildBlocks ( ) : m_blocks ( 1u ) {}
+
+    // The lists of the children of all nodes of tree_, in the order of expansion, as append ( ) would have built them
+    // (the out-lists of fsntu run newest first, they are reversed).
+    template<typename Tree>
+    [[nodiscard]] static ChildBlocks of ( Tree const & tree_ ) {
+        auto const & nodes = tree_access::nodes ( tree_ );
+        ChildBlocks blocks;
+        blocks.m_lists.resize ( nodes.size ( ) );
+        std::vector<ChildID> newest_first;
+        for ( std::size_t n = tree_.root_node.value; n < nodes.size ( ); ++n ) {
+            ParentID const parent{ n };
+            if constexpr ( tree_access::has_arcs<Tree> ) {
+                for ( auto it = tree_.cbeginOut ( parent ); it.is_valid ( ); ++it )
+                    blocks.append ( parent, it.id ( ) );
+            }
+            else if constexpr ( detail::has_next<typename Tree::Node>::value ) { // fsnt.
+                for ( typename Tree::const_out_iterator it{ tree_, parent }; it.is_valid ( ); ++it )
+                    blocks.append ( parent, it.id ( ) );
+            }
+            else { // fsntu.
+                newest_first.clear ( );
+                for ( typename Tree::const_out_iterator it{ tree_, parent }; it.is_valid ( ); ++it )
+                    newest_first.push_back ( it.id ( ) );
+                for ( auto it = newest_first.crbegin ( ); it != newest_first.crend ( ); ++it )
+                    blocks.append ( parent, *it );
+            }
+        }
+        return blocks;
+    }
+
+    void reserve ( std::size_t const parents_, std::size_t const children_ ) {
+        m_lists.reserve ( parents_ );
+        m_blocks.reserve ( 1u + children_ / Block::capacity + parents_ );
+    }
+
+    void clear ( ) {
+        m_blocks.resize ( 1u );
+        m_lists.clear ( );
+    }
+
+    // After a prune (gc::prune) of an fsnt or fsntu tree, move the lists to the new ids and drop the children that were
+    // cut, remap_ is the new id by old id (invalid if pruned), as prune returns it. The lists are rebuilt in a new arena,
+    // in order. The children of fst are arcs, which prune does not remap, rebuild those blocks with of ( ) instead.
+    void remap ( std::vector<ParentID> const & remap_ ) {
+        static_assert ( std::is_same<ParentID, ChildID>::value, "the children are arcs, rebuild the blocks with of ( )" );
+        ChildBlocks blocks;
+        blocks.reserve ( m_lists.size ( ), m_blocks.size ( ) * Block::capacity );
+        for ( std::size_t n = 1; n < m_lists.size ( ) and n < remap_.size ( ); ++n ) {
+            if ( ParentID::invalid ( ) == remap_[ n ] )
+                continue;
+            assert ( static_cast<std::size_t> ( remap_[ n ].value ) <= n );
+            forEach ( ParentID{ n }, [ & ] ( ChildID const child_ ) {
+                if ( static_cast<std::size_t> ( child_.value ) < remap_.size ( ) and
+                     ChildID::invalid ( ) != remap_[ child_.value ] )
+                    blocks.append ( remap_[ n ], remap_[ child_.value ] );
+            } );
+        }
+        *this = std::move ( blocks );
+    }
+
+    // Append child_ to the children of parent_.
+    void append ( ParentID const parent_, ChildID const child_ ) {
+        if ( static_cast<std::size_t> ( parent_.value ) >= m_lists.size ( ) )
+            m_lists.resize ( static_cast<std::size_t> ( parent_.value ) + 1u );
+        List & list = m_lists[ parent_.value ];
+        if ( not list.tail or Block::capacity == m_blocks[ list.tail ].size ) {
+            value_type const block = checked_id<ChildID> ( m_blocks.size ( ) ).value;
+            m_blocks.emplace_back ( );
+            if ( list.tail )
+                m_blocks[ list.tail ].next = block;
+            else
+                list.head = block;
+            list.tail = block;
+        }
+        Block & tail             = m_blocks[ list.tail ];
+        tail.ids[ tail.size++ ] = child_;
+        ++list.size;
+    }
+
+    [[nodiscard]] value_type size ( ParentID const parent_ ) const noexcept {
+        List const * const l = list ( parent_ );
+        return l ? l->size : value_type{ 0 };
+    }
+
+    // Call function_ ( ChildID ) for the children of parent_, in the order of appending.
+    template<typename Function>
+    void forEach ( ParentID const parent_, Function && function_ ) const {
+        List const * const l = list ( parent_ );
+        for ( value_type b = l ? l->head : value_type{ 0 }; b; b = m_blocks[ b ].next ) {
+            Block const & block = m_blocks[ b ];
+            for ( value_type i = 0; i < block.size; ++i )
+                function_ ( block.ids[ i ] );
+        }
+    }
+
+    class const_iterator {
+
+        friend class ChildBlocks;
+
+        Block const * m_blocks;
+        typename Block::value_type m_block, m_index = 0;
+
+        public:
+        using value_type        = ChildID;
+        using iterator_category = std::forward_iterator_tag;
+
+        const_iterator ( ChildBlocks const & blocks_, ParentID const parent_ ) noexcept : m_blocks{ blocks_.m_blocks.data ( ) } {
+            List const * const l = blocks_.list ( parent_ );
+            m_block              = l ? l->head : 0;
+        }
+
+        [[nodiscard]] bool is_valid ( ) const noexcept { return m_block; }
+
+        [[maybe_unused]] const_iterator & operator++ ( ) noexcept {
+            if ( ++m_index == m_blocks[ m_block ].size )
+                m_block = m_blocks[ m_block ].next, m_index = 0;
+            return *this;
+        }
+
+        [[nodiscard]] ChildID operator* ( ) const noexcept { return m_blocks[ m_block ].ids[ m_index ]; }
+    };
+
+    [[nodiscard]] const_iterator cbegin ( ParentID const parent_ ) const noexcept { return const_iterator{ *this, parent_ }; }
+
+    // The memory in use, the admin block included.
+    [[nodiscard]] std::size_t bytes ( ) const noexcept {
+        return m_blocks.size ( ) * sizeof ( Block ) + m_lists.size ( ) * sizeof ( List );
+    }
+};
+
+// The child blocks of a tree type, of arc ids (fst, fsth) or node ids (fsnt, fsntu).
+template<typename Tree, template<typename> typename Allocator = std::allocator>
+using ChildBlocksOf = ChildBlocks<typename Tree::NodeID, typename detail::child_id<Tree>::type, Allocator>;
+
+} // namespace cbl
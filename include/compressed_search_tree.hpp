@@ -0,0 +1,219 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <cereal/cereal.hpp>
+#include <cereal/archives/binary.hpp>
+
+#include "types.hpp"
+#include "tree_access.hpp"
+
+// A compact serialization format for the flat trees. All lists are in ascending
+// order (the trees only grow by appending), so the link fields (next_*, head_*,
+// tail_*, in_size, out_size, prev, next, size) are not stored, but are rebuilt on
+// load by replaying the additions in index order. What remains are the end-points
+// of the arcs (fst, fsth) or the up-links (fsnt, fsntu), stored as zig-zag varint
+// deltas from their own index (mostly a single byte in an append-only tree), the
+// hashes (fsth) and the data. Trivially copyable data is stored verbatim, other
+// data is serialized with cereal (f.e. Moves only stores the remaining moves).
+
+namespace cst {
+
+inline constexpr std::uint64_t compressed_magic   = 0x52504D435354434Dull; // "MCTSCMPR".
+inline constexpr std::uint32_t compressed_version = 1u;
+
+namespace detail {
+
+[[nodiscard]] constexpr std::uint64_t zigzag ( std::int64_t const v_ ) noexcept {
+    return ( static_cast<std::uint64_t> ( v_ ) << 1 ) ^ static_cast<std::uint64_t> ( v_ >> 63 );
+}
+[[nodiscard]] constexpr std::int64_t unzigzag ( std::uint64_t const v_ ) noexcept {
+    return static_cast<std::int64_t> ( v_ >> 1 ) ^ -static_cast<std::int64_t> ( v_ & 1u );
+}
+
+inline void put_varint ( std::ostream & out_, std::uint64_t v_ ) {
+    char buffer[ 10 ];
+    int n = 0;
+    while ( v_ >= 0x80u ) {
+        buffer[ n++ ] = static_cast<char> ( v_ | 0x80u );
+        v_ >>= 7;
+    }
+    buffer[ n++ ] = static_cast<char> ( v_ );
+    out_.write ( buffer, n );
+}
+
+[[nodiscard]] inline std::uint64_t get_varint ( std::istream & in_ ) {
+    std::uint64_t v = 0u;
+    for ( int shift = 0; shift < 64; shift += 7 ) {
+        int const c = in_.get ( );
+        if ( std::istream::traits_type::eof ( ) == c )
+            throw std::runtime_error ( "cst: unexpected end of stream" );
+        v |= static_cast<std::uint64_t> ( c & 0x7F ) << shift;
+        if ( not( c & 0x80 ) )
+            return v;
+    }
+    throw std::runtime_error ( "cst: corrupt varint" );
+}
+
+template<typename T>
+void put_data ( std::ostream & out_, cereal::BinaryOutputArchive & archive_, T const & data_ ) {
+    if constexpr ( std::is_trivially_copyable<T>::value )
+        out_.write ( reinterpret_cast<char const *> ( &data_ ), sizeof ( T ) );
+    else
+        archive_ ( data_ );
+}
+
+template<typename T>
+[[nodiscard]] T get_data ( std::istream & in_, cereal::BinaryInputArchive & archive_ ) {
+    T data;
+    if constexpr ( std::is_trivially_copyable<T>::value )
+        in_.read ( reinterpret_cast<char *> ( &data ), sizeof ( T ) );
+    else
+        archive_ ( data );
+    if ( not in_ )
+        throw std::runtime_error ( "cst: unexpected end of stream" );
+    return data;
+}
+
+template<typename Tree>
+using node_data_t = typename Tree::Node::data_type;
+
+} // namespace detail
+
+template<typename Tree>
+void save ( Tree const & tree_, std::ostream & out_ ) {
+    cereal::BinaryOutputArchive archive ( out_ );
+    auto const & nodes = tree_access::nodes ( tree_ );
+    assert ( nodes.size ( ) > 1u and 1 == tree_.root_node.value );
+    std::uint64_t const header[ 2 ] = { compressed_magic, compressed_version };
+    out_.write ( reinterpret_cast<char const *> ( header ), sizeof ( header ) );
+    detail::put_varint ( out_, nodes.size ( ) - 1u );
+    for ( std::size_t n = 1u; n < nodes.size ( ); ++n ) {
+        if constexpr ( tree_access::has_transpositions<Tree> )
+            out_.write ( reinterpret_cast<char const *> ( &nodes[ n ].hash ), sizeof ( nodes[ n ].hash ) );
+        if constexpr ( not tree_access::has_arcs<Tree> ) {
+            if ( n > 1u )
+                detail::put_varint ( out_, detail::zigzag ( static_cast<std::int64_t> ( n ) - nodes[ n ].up.value ) );
+        }
+        detail::put_data ( out_, archive, nodes[ n ].data );
+    }
+    if constexpr ( tree_access::has_arcs<Tree> ) {
+        // Arc 0 is the invalid arc, arc 1 is the root arc [pointing to the root node].
+        auto const & arcs = tree_access::arcs ( tree_ );
+        detail::put_varint ( out_, arcs.size ( ) - 2u );
+        for ( std::size_t a = 2u; a < arcs.size ( ); ++a ) {
+            std::int64_t const target = arcs[ a ].target.value;
+            detail::put_varint ( out_, detail::zigzag ( target - static_cast<std::int64_t> ( a ) ) );
+            detail::put_varint ( out_, detail::zigzag ( target - arcs[ a ].source.value ) );
+            if constexpr ( not std::is_void<typename Tree::Arc::data_type>::value )
+                detail::put_data ( out_, archive, tree_access::data ( arcs[ a ] ) );
+        }
+    }
+    if ( not out_ )
+        throw std::runtime_error ( "cst: write failed" );
+}
+
+template<typename Tree>
+[[nodiscard]] Tree load ( std::istream & in_ ) {
+    using NodeID   = typename Tree::NodeID;
+    using NodeData = detail::node_data_t<Tree>;
+    cereal::BinaryInputArchive archive ( in_ );
+    std::uint64_t header[ 2 ];
+    in_.read ( reinterpret_cast<char *> ( header ), sizeof ( header ) );
+    if ( not in_ or compressed_magic != header[ 0 ] or compressed_version != header[ 1 ] )
+        throw std::runtime_error ( "cst: not a compressed tree" );
+    std::uint64_t const node_num = detail::get_varint ( in_ );
+    if ( not node_num )
+        throw std::runtime_error ( "cst: no root" );
+    std::uint64_t hash;
+    auto get_hash = [ &in_, &hash ] ( ) {
+        in_.read ( reinterpret_cast<char *> ( &hash ), sizeof ( hash ) );
+    };
+    if constexpr ( tree_access::has_transpositions<Tree> )
+        get_hash ( );
+    Tree tree ( detail::get_data<NodeData> ( in_, archive ) );
+    for ( std::uint64_t n = 2u; n <= node_num; ++n ) {
+        if constexpr ( tree_access::has_transpositions<Tree> ) {
+            get_hash ( );
+            tree.addNode ( std::move ( hash ), detail::get_data<NodeData> ( in_, archive ) );
+        }
+        else if constexpr ( tree_access::has_arcs<Tree> ) {
+            tree.addNode ( detail::get_data<NodeData> ( in_, archive ) );
+        }
+        else {
+            std::int64_t const up = static_cast<std::int64_t> ( n ) - detail::unzigzag ( detail::get_varint ( in_ ) );
+            if ( up < 1 or static_cast<std::uint64_t> ( up ) >= n )
+                throw std::runtime_error ( "cst: corrupt up-link" );
+            tree.add_node ( NodeID{ up }, detail::get_data<NodeData> ( in_, archive ) );
+        }
+    }
+    if constexpr ( tree_access::has_arcs<Tree> ) {
+        using ArcData               = typename Tree::Arc::data_type;
+        std::uint64_t const arc_num = detail::get_varint ( in_ );
+        for ( std::uint64_t a = 2u; a < arc_num + 2u; ++a ) {
+            std::int64_t const target = static_cast<std::int64_t> ( a ) + detail::unzigzag ( detail::get_varint ( in_ ) );
+            std::int64_t const source = target - detail::unzigzag ( detail::get_varint ( in_ ) );
+            if ( source < 1 or target < 1 or static_cast<std::uint64_t> ( source ) > node_num or
+                 static_cast<std::uint64_t> ( target ) > node_num )
+                throw std::runtime_error ( "cst: corrupt arc" );
+            if constexpr ( std::is_void<ArcData>::value )
+                tree.addArc ( NodeID{ source }, NodeID{ target } );
+            else
+                tree.addArc ( NodeID{ source }, NodeID{ target },
+                              detail::get_data<ArcData> ( in_, archive ) );
+        }
+    }
+    return tree;
+}
+
+template<typename Tree>
+void save ( Tree const & tree_, std::filesystem::path const & path_ ) {
+    std::ofstream out ( path_, std::ios::binary | std::ios::trunc );
+    if ( not out )
+        throw std::runtime_error ( "cst: cannot open " + path_.string ( ) );
+    save ( tree_, out );
+}
+
+template<typename Tree>
+[[nodiscard]] Tree load ( std::filesystem::path const & path_ ) {
+    std::ifstream in ( path_, std::ios::binary );
+    if ( not in )
+        throw std::runtime_error ( "cst: cannot open " + path_.string ( ) );
+    return load<Tree> ( in );
+}
+
+} // namespace cst
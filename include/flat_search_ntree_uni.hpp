@@ -28,9 +28,11 @@
 #include <cstdint>
 #include <cstdlib>
 
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <optional>
 #include <vector>
 
@@ -41,28 +43,31 @@
 #include <cereal/types/vector.hpp>
 
 #include "types.hpp"
+#include "tree_profile.hpp"
 
 namespace fsntu {
 
-template<typename NodeData>
+template<typename NodeData, template<typename> typename Allocator = std::allocator, typename IdType = Int>
 class SearchTree;
 
 namespace detail {
 
 #define NODEID_INVALID_VALUE ( 0 )
 
+template<typename IdType>
 struct NodeID {
 
-    Int value;
+    using value_type = IdType;
+
+    IdType value;
 
     static constexpr NodeID invalid ( ) noexcept { return NodeID{ }; }
 
     constexpr explicit NodeID ( ) noexcept : value{ NODEID_INVALID_VALUE } {}
-    explicit NodeID ( Int && v_ ) noexcept : value{ std::move ( v_ ) } {}
-    explicit NodeID ( Int const & v_ ) noexcept : value{ v_ } {}
-    explicit NodeID ( std::size_t const v_ ) noexcept : value{ static_cast<Int> ( v_ ) } {}
+    template<typename Integral, typename = std::enable_if_t<std::is_integral<Integral>::value>>
+    constexpr explicit NodeID ( Integral const v_ ) noexcept : value{ static_cast<IdType> ( v_ ) } {}
 
-    [[nodiscard]] constexpr Int operator( ) ( ) const noexcept { return value; }
+    [[nodiscard]] constexpr IdType operator( ) ( ) const noexcept { return value; }
 
     [[nodiscard]] bool operator== ( NodeID const rhs_ ) const noexcept { return value == rhs_.value; }
     [[nodiscard]] bool operator!= ( NodeID const rhs_ ) const noexcept { return value != rhs_.value; }
@@ -92,13 +97,13 @@ struct NodeID {
     }
 };
 
-template<typename DataType>
+template<typename DataType, typename IdType>
 struct Node { // 16
 
-    NodeID up, prev, tail; // 12
-    Int size = 0;          // 4
+    NodeID<IdType> up, prev, tail; // 12
+    IdType size = 0;               // 4
 
-    using type      = NodeID;
+    using type      = NodeID<IdType>;
     using data_type = DataType;
 
     constexpr Node ( ) noexcept {}
@@ -129,16 +134,16 @@ struct Node { // 16
 
 } // namespace detail.
 
-template<typename NodeData>
+template<typename NodeData, template<typename> typename Allocator, typename IdType>
 class SearchTree {
 
     public:
-    using NodeID = detail::NodeID;
-    using Node   = detail::Node<NodeData>;
-    using Nodes  = std::vector<Node>;
+    using NodeID = detail::NodeID<IdType>;
+    using Node   = detail::Node<NodeData, IdType>;
+    using Nodes  = std::vector<Node, Allocator<Node>>;
     // using Nodes = sax::vm_vector<Type, Int, 1'000'000>;
 
-    using size_type       = Int;
+    using size_type       = IdType;
     using difference_type = typename Nodes::difference_type;
     using value_type      = typename Nodes::value_type;
     using reference       = typename Nodes::reference;
@@ -156,8 +161,8 @@ class SearchTree {
     void reserve ( size_type c_ ) { m_nodes.reserve ( static_cast<typename Nodes::size_type> ( c_ ) ); }
 
     template<typename... Args>
-    [[maybe_unused]] NodeID add_node ( NodeID const source_, Args &&... args_ ) noexcept {
-        NodeID id{ m_nodes.size ( ) };
+    [[maybe_unused]] NodeID add_node ( NodeID const source_, Args &&... args_ ) {
+        NodeID id = checked_id<NodeID> ( m_nodes.size ( ) );
         Node & t = m_nodes.emplace_back ( std::forward<Args> ( args_ )... );
         t.up     = source_;
         Node & s = m_nodes[ source_.value ];
@@ -167,6 +172,43 @@ class SearchTree {
         return id;
     }
 
+    // Add count_ children to source_ in one step, generator_ ( i ) returns the data of the i-th child. The children are
+    // appended contiguously (see child) and linked to source_ once. Returns the first child, the children are
+    // [ first, first + count_ ).
+    template<typename Generator>
+    [[maybe_unused]] NodeID add_children ( NodeID const source_, std::size_t const count_, Generator && generator_ ) {
+        if ( not count_ )
+            return NodeID::invalid ( );
+        NodeID const first = checked_id<NodeID> ( m_nodes.size ( ) ), last = checked_id<NodeID> ( m_nodes.size ( ) + count_ - 1 );
+        reserve_more ( m_nodes, count_ );
+        NodeID const tail = m_nodes[ source_.value ].tail;
+        for ( std::size_t i = 0; i < count_; ++i ) {
+            NodeID const id{ first.value + i };
+            Node & node = m_nodes.emplace_back ( generator_ ( i ) );
+            node.up     = source_;
+            node.prev   = id != first ? NodeID{ id.value - 1 } : tail;
+        }
+        Node & source = m_nodes[ source_.value ];
+        source.tail   = last;
+        source.size += static_cast<size_type> ( count_ );
+        return first;
+    }
+
+    // Walk from leaf_ up to the root, along the up-links, and apply update_ ( data, value ) to every node on the way, the
+    // leaf first. If update_ returns a value, that value goes to the parent (f.e. the negation, negamax), otherwise all
+    // nodes get value_. The parent is prefetched before the update of a node, the (likely) miss on the parent overlaps
+    // with the update. The descent does not have to keep a path.
+    template<typename Value, typename Update>
+    void backpropagate ( NodeID const leaf_, Value value_, Update && update_ ) {
+        for ( NodeID node = leaf_; NodeID::invalid ( ) != node; ) {
+            Node & n        = m_nodes[ node.value ];
+            NodeID const up = n.up;
+            prefetch ( m_nodes.data ( ) + up.value ); // The up-link of the root is the admin node, no test needed.
+            apply_update ( update_, n.data, value_ );
+            node = up;
+        }
+    }
+
     [[nodiscard]] const_iterator begin ( ) const noexcept { return m_nodes.begin ( ); }
     [[nodiscard]] const_iterator cbegin ( ) const noexcept { return begin ( ); }
     [[nodiscard]] iterator begin ( ) noexcept { return const_cast<iterator> ( std::as_const ( this )->begin ( ) ); }
@@ -251,10 +293,44 @@ class SearchTree {
 
     [[nodiscard]] size_type size ( ) const noexcept { return static_cast<size_type> ( m_nodes.size ( ) ) - 1; }
 
-    // Make root_ the new root of the tree and discard the rest of the tree.
-    void root ( NodeID const root_ ) {
+    // Depth and branching histograms, leaves and memory use (slack included), in one pass over the flat vectors.
+    [[nodiscard]] TreeProfile profile ( ) const { return TreeProfile::of ( *this ); }
+
+    // The children of node_ occupy consecutive indices, as after a breadth-first re-root (or relayout).
+    [[nodiscard]] bool is_contiguous ( NodeID const node_ ) const noexcept {
+        for ( NodeID child = m_nodes[ node_.value ].tail; NodeID::invalid ( ) != child; child = m_nodes[ child.value ].prev )
+            if ( NodeID::invalid ( ) != m_nodes[ child.value ].prev and m_nodes[ child.value ].prev.value != child.value - 1 )
+                return false;
+        return true;
+    }
+
+    // Child i_ of node_, in the order of addition (the reverse of the out-iterator), node_ must be contiguous.
+    [[nodiscard]] NodeID child ( NodeID const node_, size_type const i_ ) const noexcept {
+        assert ( i_ < arity ( node_ ) and is_contiguous ( node_ ) );
+        return NodeID{ m_nodes[ node_.value ].tail.value - m_nodes[ node_.value ].size + 1 + i_ };
+    }
+
+    // Make root_ the new root of the tree and discard the rest of the tree. Depth first, the copy follows a stack and
+    // the children of a node end up reversed. Breadth first, the children of every node are contiguous and keep their
+    // order, the copy is its own queue.
+    void root ( NodeID const root_, Layout const layout_ = Layout::depth_first ) {
         assert ( NodeID::invalid ( ) != root_ );
         SearchTree sub_tree{ std::move ( m_nodes[ root_.value ].data ) };
+        if ( Layout::breadth_first == layout_ ) {
+            std::vector<NodeID> old{ NodeID::invalid ( ), root_ }; // The old NodeID's by new NodeID.
+            for ( std::size_t parent = 1; parent < old.size ( ); ++parent ) {
+                std::size_t const first = old.size ( );
+                for ( NodeID child = m_nodes[ old[ parent ].value ].tail; NodeID::invalid ( ) != child;
+                      child = m_nodes[ child.value ].prev )
+                    old.push_back ( child );
+                std::reverse ( std::begin ( old ) + first, std::end ( old ) );
+                for ( std::size_t child = first; child < old.size ( ); ++child )
+                    sub_tree.add_node ( NodeID{ parent }, std::move ( m_nodes[ old[ child ].value ].data ) );
+            }
+            std::swap ( m_nodes, sub_tree.m_nodes );
+            m_generation.bump ( );
+            return;
+        }
         std::vector<NodeID> visited ( m_nodes.size ( ) );
         visited[ root_.value ] = sub_tree.root_node;
         std::vector<NodeID> stack;
@@ -271,21 +347,32 @@ class SearchTree {
                 }
         }
         std::swap ( m_nodes, sub_tree.m_nodes );
+        m_generation.bump ( );
     }
 
+    // Renumbers the tree breadth first, in place, see root.
+    void relayout ( ) { root ( root_node, Layout::breadth_first ); }
+
     void flatten ( ) {
         SearchTree sub_tree{ std::move ( m_nodes[ root_node.value ].data ) };
         for ( NodeID child = m_nodes[ root_node.value ].tail; NodeID::invalid ( ) != child; child = m_nodes[ child.value ].prev )
             sub_tree.add_node ( root_node, std::move ( m_nodes[ child.value ].data ) );
         std::swap ( m_nodes, sub_tree.m_nodes );
+        m_generation.bump ( );
     }
 
+    // See Generation, changes when the ids of the tree go stale.
+    [[nodiscard]] std::uint64_t generation ( ) const noexcept { return m_generation.value ( ); }
+
     // Data members.
 
     NodeID root_node;
 
     private:
+    friend class ::tree_access;
+
     Nodes m_nodes;
+    Generation m_generation;
 };
 
 } // namespace fsntu
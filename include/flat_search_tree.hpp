@@ -31,6 +31,7 @@
 #include <functional>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <optional>
 #include <vector>
 
@@ -43,30 +44,36 @@
 #include <sax/vm_backed.hpp>
 
 #include "types.hpp"
+#include "tree_access.hpp"
+#include "tree_profile.hpp"
+#include "traversal.hpp"
 #include "link.hpp"
 #include "path.hpp"
 
 namespace fst {
 
-template<typename ArcData, typename NodeData>
+template<typename ArcData, typename NodeData, template<typename> typename Allocator = std::allocator, typename IdType = Int,
+         Links Shape = Links::graph>
 class SearchTree;
 
 namespace detail {
 
 #define ARCID_INVALID_VALUE ( 0 )
 
+template<typename IdType>
 struct ArcID {
 
-    Int value;
+    using value_type = IdType;
+
+    IdType value;
 
     static constexpr ArcID invalid ( ) noexcept { return ArcID{ }; }
 
     constexpr explicit ArcID ( ) noexcept : value{ ARCID_INVALID_VALUE } {}
-    explicit ArcID ( Int && v_ ) noexcept : value{ std::move ( v_ ) } {}
-    explicit ArcID ( Int const & v_ ) noexcept : value{ v_ } {}
-    explicit ArcID ( std::size_t const v_ ) noexcept : value{ static_cast<Int> ( v_ ) } {}
+    template<typename Integral, typename = std::enable_if_t<std::is_integral<Integral>::value>>
+    constexpr explicit ArcID ( Integral const v_ ) noexcept : value{ static_cast<IdType> ( v_ ) } {}
 
-    [[nodiscard]] constexpr Int operator( ) ( ) const noexcept { return value; }
+    [[nodiscard]] constexpr IdType operator( ) ( ) const noexcept { return value; }
 
     [[nodiscard]] bool operator== ( ArcID const rhs_ ) const noexcept { return value == rhs_.value; }
     [[nodiscard]] bool operator!= ( ArcID const rhs_ ) const noexcept { return value != rhs_.value; }
@@ -98,18 +105,20 @@ struct ArcID {
 
 #define NODEID_INVALID_VALUE ( 0 )
 
+template<typename IdType>
 struct NodeID {
 
-    Int value;
+    using value_type = IdType;
+
+    IdType value;
 
     static constexpr NodeID invalid ( ) noexcept { return NodeID{ }; }
 
     constexpr explicit NodeID ( ) noexcept : value{ NODEID_INVALID_VALUE } {}
-    explicit NodeID ( Int && v_ ) noexcept : value{ std::move ( v_ ) } {}
-    explicit NodeID ( Int const & v_ ) noexcept : value{ v_ } {}
-    explicit NodeID ( std::size_t const v_ ) noexcept : value{ static_cast<Int> ( v_ ) } {}
+    template<typename Integral, typename = std::enable_if_t<std::is_integral<Integral>::value>>
+    constexpr explicit NodeID ( Integral const v_ ) noexcept : value{ static_cast<IdType> ( v_ ) } {}
 
-    [[nodiscard]] constexpr Int operator( ) ( ) const noexcept { return value; }
+    [[nodiscard]] constexpr IdType operator( ) ( ) const noexcept { return value; }
 
     [[nodiscard]] bool operator== ( NodeID const rhs_ ) const noexcept { return value == rhs_.value; }
     [[nodiscard]] bool operator!= ( NodeID const rhs_ ) const noexcept { return value != rhs_.value; }
@@ -139,21 +148,21 @@ struct NodeID {
     }
 };
 
-template<typename DataType>
+template<typename DataType, typename IdType, Links Shape = Links::graph>
 struct Arc {
 
-    NodeID source, target;
-    ArcID next_in, next_out;
+    NodeID<IdType> source, target;
+    ArcID<IdType> next_in, next_out;
 
-    using type      = ArcID;
+    using type      = ArcID<IdType>;
     using data_type = DataType;
 
     constexpr Arc ( ) noexcept {}
     template<typename... Args>
-    Arc ( NodeID && s_, NodeID && t_, Args &&... args_ ) noexcept :
+    Arc ( NodeID<IdType> && s_, NodeID<IdType> && t_, Args &&... args_ ) noexcept :
         source{ std::move ( s_ ) }, target{ std::move ( t_ ) }, data{ std::forward<Args> ( args_ )... } {}
     template<typename... Args>
-    Arc ( NodeID const s_, NodeID const t_, Args &&... args_ ) noexcept :
+    Arc ( NodeID<IdType> const s_, NodeID<IdType> const t_, Args &&... args_ ) noexcept :
         source{ s_ }, target{ t_ }, data{ std::forward<Args> ( args_ )... } {}
 
     template<typename Stream>
@@ -168,13 +177,14 @@ struct Arc {
     }
 
     protected:
-    template<typename ArcData, typename NodeData>
+    template<typename ArcData, typename NodeData, template<typename> typename Allocator, typename IdType_, Links Shape_>
     friend class fst::SearchTree;
 
     DataType data;
 
     private:
     friend class cereal::access;
+    friend class ::tree_access;
 
     template<class Archive>
     void serialize ( Archive & ar_ ) {
@@ -182,13 +192,13 @@ struct Arc {
     }
 };
 
-template<typename DataType>
+template<typename DataType, typename IdType, Links Shape = Links::graph>
 struct Node { // 24
 
-    ArcID head_in, tail_in, head_out, tail_out;
-    Int in_size = 0, out_size = 0;
+    ArcID<IdType> head_in, tail_in, head_out, tail_out;
+    IdType in_size = 0, out_size = 0;
 
-    using type      = NodeID;
+    using type      = NodeID<IdType>;
     using data_type = DataType;
 
     constexpr Node ( ) noexcept {}
@@ -219,21 +229,101 @@ struct Node { // 24
     }
 };
 
+// In a tree (Links::tree) a node has one in-arc, the parent arc, there are no in-lists.
+template<typename DataType, typename IdType>
+struct Arc<DataType, IdType, Links::tree> {
+
+    NodeID<IdType> source, target;
+    ArcID<IdType> next_out;
+
+    using type      = ArcID<IdType>;
+    using data_type = DataType;
+
+    constexpr Arc ( ) noexcept {}
+    template<typename... Args>
+    Arc ( NodeID<IdType> && s_, NodeID<IdType> && t_, Args &&... args_ ) noexcept :
+        source{ std::move ( s_ ) }, target{ std::move ( t_ ) }, data{ std::forward<Args> ( args_ )... } {}
+    template<typename... Args>
+    Arc ( NodeID<IdType> const s_, NodeID<IdType> const t_, Args &&... args_ ) noexcept :
+        source{ s_ }, target{ t_ }, data{ std::forward<Args> ( args_ )... } {}
+
+    template<typename Stream>
+    [[maybe_unused]] friend Stream & operator<< ( Stream & out_, Arc const a_ ) noexcept {
+        if constexpr ( std::is_same<typename Stream::char_type, wchar_t>::value ) {
+            out_ << L'<' << a_.source << L' ' << a_.target << L' ' << a_.next_out << L'>';
+        }
+        else {
+            out_ << '<' << a_.source << ' ' << a_.target << ' ' << a_.next_out << '>';
+        }
+        return out_;
+    }
+
+    protected:
+    template<typename ArcData, typename NodeData, template<typename> typename Allocator, typename IdType_, Links Shape_>
+    friend class fst::SearchTree;
+
+    DataType data;
+
+    private:
+    friend class cereal::access;
+    friend class ::tree_access;
+
+    template<class Archive>
+    void serialize ( Archive & ar_ ) {
+        ar_ ( source, target, next_out, data );
+    }
+};
+
+template<typename DataType, typename IdType>
+struct Node<DataType, IdType, Links::tree> { // 16
+
+    ArcID<IdType> parent, head_out, tail_out;
+    IdType out_size = 0;
+
+    using type      = NodeID<IdType>;
+    using data_type = DataType;
+
+    constexpr Node ( ) noexcept {}
+    template<typename... Args>
+    Node ( Args &&... args_ ) noexcept : data{ std::forward<Args> ( args_ )... } {}
+
+    template<typename Stream>
+    [[maybe_unused]] friend Stream & operator<< ( Stream & out_, Node const node_ ) noexcept {
+        if constexpr ( std::is_same<typename Stream::char_type, wchar_t>::value ) {
+            out_ << L'<' << node_.parent << L' ' << node_.head_out << L' ' << node_.tail_out << L' ' << node_.out_size << L'>';
+        }
+        else {
+            out_ << '<' << node_.parent << ' ' << node_.head_out << ' ' << node_.tail_out << ' ' << node_.out_size << '>';
+        }
+        return out_;
+    }
+
+    DataType data;
+
+    private:
+    friend class cereal::access;
+
+    template<class Archive>
+    void serialize ( Archive & ar_ ) {
+        ar_ ( parent, head_out, tail_out, out_size, data );
+    }
+};
+
 } // namespace detail.
 
-template<typename ArcData, typename NodeData>
+template<typename ArcData, typename NodeData, template<typename> typename Allocator, typename IdType, Links Shape>
 class SearchTree {
 
     template<typename Type>
     // using vector = sax::vm_vector<Type, Int, 1'000'000>;
-    using vector = std::vector<Type>;
+    using vector = std::vector<Type, Allocator<Type>>;
 
     public:
-    using ArcID        = detail::ArcID;
-    using NodeID       = detail::NodeID;
-    using Arc          = detail::Arc<ArcData>;
+    using ArcID        = detail::ArcID<IdType>;
+    using NodeID       = detail::NodeID<IdType>;
+    using Arc          = detail::Arc<ArcData, IdType, Shape>;
     using Arcs         = vector<Arc>;
-    using Node         = detail::Node<NodeData>;
+    using Node         = detail::Node<NodeData, IdType, Shape>;
     using Nodes        = vector<Node>;
     using Link         = Link<SearchTree>;
     using OptionalLink = OptionalLink<SearchTree>;
@@ -247,34 +337,84 @@ class SearchTree {
         root_arc{ 1 }, root_node{ 1 }, m_arcs{ Arc{ }, Arc{ NodeID::invalid ( ), root_node } }, m_nodes{
             Node{ }, Node{ std::forward<Args> ( args_ )... }
         } {
-        m_nodes[ root_node.value ].head_in = m_nodes[ root_node.value ].tail_in = root_arc;
-        m_nodes[ root_node.value ].in_size = 1, m_nodes[ root_node.value ].out_size = 0;
+        if constexpr ( Links::tree == Shape ) {
+            m_nodes[ root_node.value ].parent = root_arc;
+        }
+        else {
+            m_nodes[ root_node.value ].head_in = m_nodes[ root_node.value ].tail_in = root_arc;
+            m_nodes[ root_node.value ].in_size = 1;
+        }
+        m_nodes[ root_node.value ].out_size = 0;
     }
 
     template<typename... Args>
-    [[maybe_unused]] ArcID addArc ( NodeID const source_, NodeID const target_, Args &&... args_ ) noexcept {
-        ArcID const id{ m_arcs.size ( ) };
+    [[maybe_unused]] ArcID addArc ( NodeID const source_, NodeID const target_, Args &&... args_ ) {
+        ArcID const id = checked_id<ArcID> ( m_arcs.size ( ) );
         m_arcs.emplace_back ( source_, target_, std::forward<Args> ( args_ )... );
         if ( ArcID::invalid ( ) == m_nodes[ source_.value ].head_out )
             m_nodes[ source_.value ].tail_out = m_nodes[ source_.value ].head_out = id;
         else
             m_nodes[ source_.value ].tail_out = m_arcs[ m_nodes[ source_.value ].tail_out.value ].next_out = id;
         ++m_nodes[ source_.value ].out_size;
-        if ( ArcID::invalid ( ) == m_nodes[ target_.value ].head_in )
-            m_nodes[ target_.value ].tail_in = m_nodes[ target_.value ].head_in = id;
-        else
-            m_nodes[ target_.value ].tail_in = m_arcs[ m_nodes[ target_.value ].tail_in.value ].next_in = id;
-        ++m_nodes[ target_.value ].in_size;
+        if constexpr ( Links::tree == Shape ) {
+            assert ( ArcID::invalid ( ) == m_nodes[ target_.value ].parent ); // A node has one parent in a tree.
+            m_nodes[ target_.value ].parent = id;
+        }
+        else {
+            if ( ArcID::invalid ( ) == m_nodes[ target_.value ].head_in )
+                m_nodes[ target_.value ].tail_in = m_nodes[ target_.value ].head_in = id;
+            else
+                m_nodes[ target_.value ].tail_in = m_arcs[ m_nodes[ target_.value ].tail_in.value ].next_in = id;
+            ++m_nodes[ target_.value ].in_size;
+        }
         return id;
     }
 
     template<typename... Args>
-    [[maybe_unused]] NodeID addNode ( Args &&... args_ ) noexcept {
-        NodeID const id{ m_nodes.size ( ) };
+    [[maybe_unused]] NodeID addNode ( Args &&... args_ ) {
+        NodeID const id = checked_id<NodeID> ( m_nodes.size ( ) );
         m_nodes.emplace_back ( std::forward<Args> ( args_ )... );
         return id;
     }
 
+    // Add count_ children to source_ in one step, generator_ ( i ) returns the arc data and the node data of the i-th
+    // child (a pair, a tuple or a struct of the two). The arcs and the nodes are appended contiguously and the out-list
+    // of source_ is spliced once. Returns the first arc, the arcs are [ first, first + count_ ), their targets are
+    // contiguous likewise.
+    template<typename Generator>
+    [[maybe_unused]] ArcID addChildren ( NodeID const source_, std::size_t const count_, Generator && generator_ ) {
+        if ( not count_ )
+            return ArcID::invalid ( );
+        ArcID const first = checked_id<ArcID> ( m_arcs.size ( ) ), last = checked_id<ArcID> ( m_arcs.size ( ) + count_ - 1 );
+        NodeID const first_target = checked_id<NodeID> ( m_nodes.size ( ) );
+        [[maybe_unused]] NodeID const last_target = checked_id<NodeID> ( m_nodes.size ( ) + count_ - 1 );
+        reserve_more ( m_arcs, count_ );
+        reserve_more ( m_nodes, count_ );
+        for ( std::size_t i = 0; i < count_; ++i ) {
+            auto && [ arc_data, node_data ] = generator_ ( i );
+            ArcID const id{ first.value + i };
+            NodeID const target{ first_target.value + i };
+            Node & node = m_nodes.emplace_back ( std::move ( node_data ) );
+            if constexpr ( Links::tree == Shape ) {
+                node.parent = id;
+            }
+            else {
+                node.head_in = node.tail_in = id;
+                node.in_size                = 1;
+            }
+            m_arcs.emplace_back ( source_, target, std::move ( arc_data ) ).next_out =
+                id != last ? ArcID{ id.value + 1 } : ArcID::invalid ( );
+        }
+        Node & source = m_nodes[ source_.value ];
+        if ( ArcID::invalid ( ) == source.head_out )
+            source.head_out = first;
+        else
+            m_arcs[ source.tail_out.value ].next_out = first;
+        source.tail_out = last;
+        source.out_size += static_cast<IdType> ( count_ );
+        return first;
+    }
+
     class node_iterator {
 
         friend class SearchTree;
@@ -410,12 +550,12 @@ class SearchTree {
         using iterator_category = std::forward_iterator_tag;
 
         in_iterator ( SearchTree & tree_, NodeID const node_ ) noexcept :
-            m_st{ tree_ }, m_id{ m_st.m_nodes[ node_.value ].head_in } {}
+            m_st{ tree_ }, m_id{ tree_access::head_in ( m_st.m_nodes[ node_.value ] ) } {}
 
         [[nodiscard]] bool is_valid ( ) const noexcept { return ArcID::invalid ( ) != m_id; }
 
         [[maybe_unused]] in_iterator & operator++ ( ) noexcept {
-            m_id = m_st.m_arcs[ m_id.value ].next_in;
+            m_id = tree_access::next_in ( m_st.m_arcs[ m_id.value ] );
             return *this;
         }
 
@@ -443,12 +583,12 @@ class SearchTree {
         using iterator_category = std::forward_iterator_tag;
 
         const_in_iterator ( SearchTree const & tree_, NodeID const node_ ) noexcept :
-            m_st{ tree_ }, m_id{ m_st.m_nodes[ node_.value ].head_in } {}
+            m_st{ tree_ }, m_id{ tree_access::head_in ( m_st.m_nodes[ node_.value ] ) } {}
 
         [[nodiscard]] bool is_valid ( ) const noexcept { return ArcID::invalid ( ) != m_id; }
 
         [[maybe_unused]] const_in_iterator & operator++ ( ) noexcept {
-            m_id = m_st.m_arcs[ m_id.value ].next_in;
+            m_id = tree_access::next_in ( m_st.m_arcs[ m_id.value ] );
             return *this;
         }
 
@@ -540,10 +680,13 @@ class SearchTree {
     [[nodiscard]] bool isLeaf ( NodeID const node_ ) const noexcept { return not m_nodes[ node_.value ].out_size; }
     [[nodiscard]] bool isInternal ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].out_size; }
 
-    [[nodiscard]] Int inArcNum ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].in_size; }
-    [[nodiscard]] Int outArcNum ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].out_size; }
+    [[nodiscard]] IdType inArcNum ( NodeID const node_ ) const noexcept { return tree_access::in_size ( m_nodes[ node_.value ] ); }
+    [[nodiscard]] IdType outArcNum ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].out_size; }
+
+    [[nodiscard]] bool hasInArc ( NodeID const node_ ) const noexcept { return tree_access::in_size ( m_nodes[ node_.value ] ); }
 
-    [[nodiscard]] bool hasInArc ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].in_size; }
+    // The (first) in-arc of node_, the parent arc in a tree.
+    [[nodiscard]] ArcID parentArc ( NodeID const node_ ) const noexcept { return tree_access::head_in ( m_nodes[ node_.value ] ); }
     [[nodiscard]] bool hasOutArc ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].out_size; }
 
     [[nodiscard]] in_iterator beginIn ( NodeID const node_ ) noexcept { return in_iterator{ *this, node_ }; }
@@ -562,126 +705,97 @@ class SearchTree {
     // The number of valid arcs. This is not the same as the size of
     // the arcs-vector, which allows for some additional admin elements,
     // use arcsSize ( ) instead.
-    [[nodiscard]] Int arcNum ( ) const noexcept { return static_cast<Int> ( m_arcs.size ( ) ) - 2; }
+    [[nodiscard]] IdType arcNum ( ) const noexcept { return static_cast<IdType> ( m_arcs.size ( ) ) - 2; }
     // The number of valid nodes. This is not the same as the size of
     // the arcs-vector, which allows for some additional admin elements,
     // use nodesSize ( ) instead.
-    [[nodiscard]] Int nodeNum ( ) const noexcept { return static_cast<Int> ( m_nodes.size ( ) ) - 1; }
+    [[nodiscard]] IdType nodeNum ( ) const noexcept { return static_cast<IdType> ( m_nodes.size ( ) ) - 1; }
 
     // The size of the arcs-vector (allows for some admin elements).
     [[nodiscard]] std::size_t arcsSize ( ) const noexcept { return m_arcs.size ( ); }
     // The size of the nodes-vector (allows for some admin elements).
     [[nodiscard]] std::size_t nodesSize ( ) const noexcept { return m_nodes.size ( ); }
 
-    // Destructively construct a sub-tree out of the current tree [Depth First].
+    // Depth and branching histograms, leaves and memory use (slack included), in one pass over the flat vectors.
+    [[nodiscard]] TreeProfile profile ( ) const { return TreeProfile::of ( *this ); }
+
+    // Destructively construct a sub-tree out of the current tree [Breadth First]. The children of a node are
+    // discovered together, they get contiguous ids and keep their order.
     [[nodiscard]] SearchTree makeSubTree ( NodeID const root_node_to_be_ ) {
         assert ( NodeID::invalid ( ) != root_node_to_be_ );
         assert ( root_node != root_node_to_be_ );
-        SearchTree sub_tree{ std::move ( m_nodes[ root_node_to_be_.value ].data ) };
-        // The Visited-vector stores the new NodeID's indexed by old NodeID's,
-        // old NodeID's not present in the new tree have a value of NodeID::invalid ( ).
-        Visited visited ( m_nodes.size ( ), NodeID::invalid ( ) );
-        visited[ root_node_to_be_.value ] = sub_tree.root_node;
-        Stack stack ( { root_node_to_be_ } );
-        while ( stack.size ( ) ) {
-            NodeID const parent = stack.back ( );
-            stack.pop_back ( );
-            for ( ArcID a = m_nodes[ parent.value ].head_out; ArcID::invalid ( ) != a; a = m_arcs[ a.value ].next_out ) {
-                NodeID const child{ m_arcs[ a.value ].target };
-                if ( NodeID::invalid ( ) == visited[ child.value ] ) { // Not visited yet.
-                    visited[ child.value ] = sub_tree.addNode ( std::move ( m_nodes[ child.value ].data ) );
-                    stack.push_back ( child );
-                }
-                sub_tree.addArc ( visited[ parent.value ], visited[ child.value ], std::move ( m_arcs[ a.value ].data ) );
+        // A visitor of the breadth first traversal, a node is copied when it is discovered, an arc when it is scanned.
+        struct Copy : trv::Visitor {
+            SearchTree & tree;
+            SearchTree sub_tree;
+            // The Visited-vector stores the new NodeID's indexed by old NodeID's,
+            // old NodeID's not present in the new tree have a value of NodeID::invalid ( ).
+            Visited visited;
+
+            trv::Visit arc ( NodeID const source_, ArcID const arc_, NodeID const target_, bool const first_ ) {
+                if ( first_ )
+                    visited[ target_.value ] = sub_tree.addNode ( std::move ( tree.m_nodes[ target_.value ].data ) );
+                sub_tree.addArc ( visited[ source_.value ], visited[ target_.value ],
+                                  std::move ( tree.m_arcs[ arc_.value ].data ) );
+                return trv::Visit::proceed;
             }
-        }
-        return sub_tree;
+        };
+        Copy copy{ { }, *this, SearchTree{ std::move ( m_nodes[ root_node_to_be_.value ].data ) },
+                   Visited ( m_nodes.size ( ), NodeID::invalid ( ) ) };
+        copy.visited[ root_node_to_be_.value ] = copy.sub_tree.root_node;
+        trv::Scratch<SearchTree> scratch;
+        trv::breadthFirst ( *this, root_node_to_be_, copy, scratch );
+        m_generation.bump ( ); // The data was moved out.
+        return std::move ( copy.sub_tree );
     }
 
-    void traverseBreadthFirst ( NodeID const root_node_to_be_ = NodeID{ 1 } ) { // Default is to walk the whole tree.
-        assert ( NodeID::invalid ( ) != root_node_to_be_ );
-        // The Visited-vector stores the new NodeID's indexed by old NodeID's,
-        // old NodeID's not present in the new tree have a value of NodeID::invalid ( ).
-        static std::vector<bool> visited;
-        visited.clear ( );
-        visited.resize ( m_nodes.size ( ), false );
-        visited[ root_node_to_be_.value ] = true;
-        static Queue queue;
-        queue.clear ( );
-        queue.push_back ( root_node_to_be_ );
-        while ( queue.size ( ) ) {
-            NodeID const parent = queue.front ( );
-            queue.pop_front ( );
-            for ( ArcID a = m_nodes[ parent.value ].head_out; ArcID::invalid ( ) != a; a = m_arcs[ a.value ].next_out ) {
-                NodeID child{ m_arcs[ a.value ].target };
-                if ( not visited[ child.value ] ) { // Not visited yet.
-                    visited[ child.value ] = true;
-                    queue.emplace_back ( std::move ( child ) );
-                    // All nodes traversed once here.
-                }
-                // All arcs traversed once here [nodes are traversed (possibly) several times].
-            }
-        }
+    // Walk the tree from root_ breadth first (depth first), reporting to visitor_, see trv::breadthFirst (depthFirst).
+    // Returns false if the visitor stopped the walk. Pass a scratch (and keep it) for walks that do not allocate.
+    template<typename Visitor>
+    [[maybe_unused]] bool traverseBreadthFirst ( NodeID const root_, Visitor && visitor_,
+                                                     trv::Scratch<SearchTree> & scratch_ ) const {
+        return trv::breadthFirst ( *this, root_, std::forward<Visitor> ( visitor_ ), scratch_ );
+    }
+    template<typename Visitor = trv::Visitor>
+    [[maybe_unused]] bool traverseBreadthFirst ( NodeID const root_ = NodeID{ 1 }, Visitor && visitor_ = Visitor{ } ) const {
+        trv::Scratch<SearchTree> scratch;
+        return trv::breadthFirst ( *this, root_, std::forward<Visitor> ( visitor_ ), scratch );
     }
 
-    void traverseDepthFirst ( NodeID const root_node_to_be_ = NodeID{ 1 } ) { // Default is to walk the whole tree.
-        assert ( NodeID::invalid ( ) != root_node_to_be_ );
-        // The Visited-vector stores the new NodeID's indexed by old NodeID's,
-        // old NodeID's not present in the new tree have a value of NodeID::invalid ( ).
-        static std::vector<bool> visited;
-        visited.clear ( );
-        visited.resize ( m_nodes.size ( ), false );
-        visited[ root_node_to_be_.value ] = true;
-        Stack stack ( { root_node_to_be_ } );
-        while ( stack.size ( ) ) {
-            NodeID const parent = stack.back ( );
-            stack.pop_back ( );
-            for ( ArcID a = m_nodes[ parent.value ].head_out; ArcID::invalid ( ) != a; a = m_arcs[ a.value ].next_out ) {
-                NodeID child{ m_arcs[ a.value ].target };
-                if ( not visited[ child.value ] ) { // Not visited yet.
-                    visited[ child.value ] = true;
-                    stack.emplace_back ( std::move ( child ) );
-                }
-            }
-        }
+    template<typename Visitor>
+    [[maybe_unused]] bool traverseDepthFirst ( NodeID const root_, Visitor && visitor_,
+                                                   trv::Scratch<SearchTree> & scratch_ ) const {
+        return trv::depthFirst ( *this, root_, std::forward<Visitor> ( visitor_ ), scratch_ );
+    }
+    template<typename Visitor = trv::Visitor>
+    [[maybe_unused]] bool traverseDepthFirst ( NodeID const root_ = NodeID{ 1 }, Visitor && visitor_ = Visitor{ } ) const {
+        trv::Scratch<SearchTree> scratch;
+        return trv::depthFirst ( *this, root_, std::forward<Visitor> ( visitor_ ), scratch );
     }
 
-    // Topological sorting, using Kahn's alogorithm (does not traverse all arcs).
-    [[nodiscard]] std::vector<NodeID> topologicalSort ( ) const noexcept {
+    // Topological sorting, using Kahn's algorithm, in O ( nodes + arcs ), see trv::topologicalSort. If layers_, the
+    // start of every layer (plus the end of the last one) is appended to it.
+    [[nodiscard]] std::vector<NodeID> topologicalSort ( std::vector<std::size_t> * const layers_ = nullptr ) const {
         std::vector<NodeID> sorted;
-        static std::vector<bool> removed_arcs;
-        removed_arcs.clear ( );
-        removed_arcs.resize ( m_arcs.size ( ), false );
-        Stack stack ( { root_node } );
-        while ( stack.size ( ) ) {
-            sorted.push_back ( stack.back ( ) );
-            stack.pop_back ( );
-            for ( ArcID out = m_nodes[ sorted.back ( ).value ].head_out; ArcID::invalid ( ) != out;
-                  out       = m_arcs[ out.value ].next_out ) {
-                removed_arcs[ out.value ] = true;
-                bool has_no_in_arcs       = true;
-                for ( ArcID in = m_nodes[ m_arcs[ out.value ].target.value ].head_in; ArcID::invalid ( ) != in;
-                      in       = m_arcs[ in.value ].next_in ) {
-                    if ( not removed_arcs[ in.value ] ) {
-                        has_no_in_arcs = false;
-                        break;
-                    }
-                }
-                if ( has_no_in_arcs )
-                    stack.push_back ( m_arcs[ out.value ].target );
-            }
-        }
+        trv::Scratch<SearchTree> scratch;
+        trv::topologicalSort ( *this, root_node, sorted, layers_, scratch );
         return sorted;
     }
 
+    // See Generation, changes when the ids of the tree go stale.
+    [[nodiscard]] std::uint64_t generation ( ) const noexcept { return m_generation.value ( ); }
+
     // Data members.
 
     ArcID root_arc;
     NodeID root_node;
 
     private:
+    friend class ::tree_access;
+
     Arcs m_arcs;
     Nodes m_nodes;
+    Generation m_generation;
 };
 
 } // namespace fst
@@ -31,6 +31,7 @@
 #include <functional>
 #include <sax/iostream.hpp>
 #include <iterator>
+#include <memory>
 #include <optional>
 #include <vector>
 #include <unordered_map>
@@ -57,12 +58,14 @@
 #include "bytell_hash_map.hpp"
 
 #include "types.hpp"
+#include "tree_profile.hpp"
+#include "traversal.hpp"
 #include "link.hpp"
 #include "path.hpp"
 
 namespace fsth {
 
-template<typename ArcData, typename NodeData>
+template<typename ArcData, typename NodeData, template<typename> typename Allocator = std::allocator, typename IdType = Int>
 class SearchTree;
 
 using Hash = std::size_t;
@@ -78,20 +81,20 @@ namespace detail {
 
 #define ARCID_INVALID_VALUE ( 0 )
 
+template<typename IdType>
 struct ArcID {
 
-    using value_type = Int;
+    using value_type = IdType;
 
-    Int value;
+    IdType value;
 
     static constexpr ArcID invalid ( ) noexcept { return ArcID{ }; }
 
     constexpr explicit ArcID ( ) noexcept : value{ ARCID_INVALID_VALUE } {}
-    constexpr explicit ArcID ( Int && v_ ) noexcept : value{ std::move ( v_ ) } {}
-    constexpr explicit ArcID ( Int const & v_ ) noexcept : value{ v_ } {}
-    constexpr explicit ArcID ( std::size_t const v_ ) noexcept : value{ static_cast<Int> ( v_ ) } {}
+    template<typename Integral, typename = std::enable_if_t<std::is_integral<Integral>::value>>
+    constexpr explicit ArcID ( Integral const v_ ) noexcept : value{ static_cast<IdType> ( v_ ) } {}
 
-    [[nodiscard]] constexpr Int operator( ) ( ) const noexcept { return value; }
+    [[nodiscard]] constexpr IdType operator( ) ( ) const noexcept { return value; }
 
     [[nodiscard]] constexpr bool operator== ( ArcID const rhs_ ) const noexcept { return value == rhs_.value; }
     [[nodiscard]] constexpr bool operator!= ( ArcID const rhs_ ) const noexcept { return value != rhs_.value; }
@@ -123,20 +126,20 @@ struct ArcID {
 
 #define NODEID_INVALID_VALUE ( 0 )
 
+template<typename IdType>
 struct NodeID {
 
-    using value_type = Int;
+    using value_type = IdType;
 
-    Int value;
+    IdType value;
 
     static constexpr NodeID invalid ( ) noexcept { return NodeID{ }; }
 
     constexpr explicit NodeID ( ) noexcept : value{ NODEID_INVALID_VALUE } {}
-    constexpr explicit NodeID ( Int && v_ ) noexcept : value{ std::move ( v_ ) } {}
-    constexpr explicit NodeID ( Int const & v_ ) noexcept : value{ v_ } {}
-    constexpr explicit NodeID ( std::size_t const v_ ) noexcept : value{ static_cast<Int> ( v_ ) } {}
+    template<typename Integral, typename = std::enable_if_t<std::is_integral<Integral>::value>>
+    constexpr explicit NodeID ( Integral const v_ ) noexcept : value{ static_cast<IdType> ( v_ ) } {}
 
-    [[nodiscard]] constexpr Int operator( ) ( ) const noexcept { return value; }
+    [[nodiscard]] constexpr IdType operator( ) ( ) const noexcept { return value; }
 
     [[nodiscard]] constexpr bool operator== ( NodeID const rhs_ ) const noexcept { return value == rhs_.value; }
     [[nodiscard]] constexpr bool operator!= ( NodeID const rhs_ ) const noexcept { return value != rhs_.value; }
@@ -166,13 +169,13 @@ struct NodeID {
     }
 };
 
-template<typename DataType>
+template<typename DataType, typename IdType>
 struct Arc {
 
-    NodeID source, target;
-    ArcID next_in, next_out;
+    NodeID<IdType> source, target;
+    ArcID<IdType> next_in, next_out;
 
-    using type      = ArcID;
+    using type      = ArcID<IdType>;
     using data_type = DataType;
 
     explicit Arc ( ) noexcept = default;
@@ -183,10 +186,10 @@ struct Arc {
     ~Arc ( ) noexcept = default;
 
     template<typename... Args>
-    Arc ( NodeID && s_, NodeID && t_, Args &&... args_ ) noexcept :
+    Arc ( NodeID<IdType> && s_, NodeID<IdType> && t_, Args &&... args_ ) noexcept :
         source{ std::move ( s_ ) }, target{ std::move ( t_ ) }, data{ std::forward<Args> ( args_ )... } {}
     template<typename... Args>
-    Arc ( NodeID const & s_, NodeID const & t_, Args &&... args_ ) noexcept :
+    Arc ( NodeID<IdType> const & s_, NodeID<IdType> const & t_, Args &&... args_ ) noexcept :
         source{ s_ }, target{ t_ }, data{ std::forward<Args> ( args_ )... } {}
 
     template<typename Stream>
@@ -201,13 +204,14 @@ struct Arc {
     }
 
     protected:
-    template<typename ArcData, typename NodeData>
+    template<typename ArcData, typename NodeData, template<typename> typename Allocator, typename IdType_>
     friend class fsth::SearchTree;
 
     DataType data;
 
     private:
     friend class cereal::access;
+    friend class ::tree_access;
 
     template<class Archive>
     void serialize ( Archive & ar_ ) {
@@ -215,13 +219,13 @@ struct Arc {
     }
 };
 
-template<>
-struct Arc<void> { // Specialization for empty Data in Arc (not for Node).
+template<typename IdType>
+struct Arc<void, IdType> { // Specialization for empty Data in Arc (not for Node).
 
-    NodeID source, target;
-    ArcID next_in, next_out;
+    NodeID<IdType> source, target;
+    ArcID<IdType> next_in, next_out;
 
-    using type      = ArcID;
+    using type      = ArcID<IdType>;
     using data_type = void;
 
     explicit Arc ( ) noexcept = default;
@@ -232,9 +236,9 @@ struct Arc<void> { // Specialization for empty Data in Arc (not for Node).
     ~Arc ( ) noexcept = default;
 
     template<typename... Args>
-    Arc ( NodeID && s_, NodeID && t_ ) noexcept : source{ std::move ( s_ ) }, target{ std::move ( t_ ) } {}
+    Arc ( NodeID<IdType> && s_, NodeID<IdType> && t_ ) noexcept : source{ std::move ( s_ ) }, target{ std::move ( t_ ) } {}
     template<typename... Args>
-    Arc ( NodeID const & s_, NodeID const & t_ ) noexcept : source{ s_ }, target{ t_ } {}
+    Arc ( NodeID<IdType> const & s_, NodeID<IdType> const & t_ ) noexcept : source{ s_ }, target{ t_ } {}
 
     template<typename Stream>
     [[maybe_unused]] friend Stream & operator<< ( Stream & out_, Arc const a_ ) noexcept {
@@ -256,15 +260,15 @@ struct Arc<void> { // Specialization for empty Data in Arc (not for Node).
     }
 };
 
-template<typename DataType>
+template<typename DataType, typename IdType>
 struct Node { // 24
 
-    ArcID head_in, tail_in, head_out, tail_out;
-    Int in_size = 0, out_size = 0;
+    ArcID<IdType> head_in, tail_in, head_out, tail_out;
+    IdType in_size = 0, out_size = 0;
 
     Hash hash;
 
-    using type      = NodeID;
+    using type      = NodeID<IdType>;
     using data_type = DataType;
 
     explicit Node ( ) noexcept {}
@@ -305,16 +309,16 @@ struct Node { // 24
 
 } // namespace detail.
 
-template<typename ArcData, typename NodeData>
+template<typename ArcData, typename NodeData, template<typename> typename Allocator, typename IdType>
 class SearchTree {
 
     public:
-    using ArcID        = detail::ArcID;
-    using NodeID       = detail::NodeID;
-    using Arc          = detail::Arc<ArcData>;
-    using Arcs         = std::vector<Arc>;
-    using Node         = detail::Node<NodeData>;
-    using Nodes        = std::vector<Node>;
+    using ArcID        = detail::ArcID<IdType>;
+    using NodeID       = detail::NodeID<IdType>;
+    using Arc          = detail::Arc<ArcData, IdType>;
+    using Arcs         = std::vector<Arc, Allocator<Arc>>;
+    using Node         = detail::Node<NodeData, IdType>;
+    using Nodes        = std::vector<Node, Allocator<Node>>;
     using Link         = Link<SearchTree>;
     using OptionalLink = OptionalLink<SearchTree>;
     using Path         = Path<SearchTree>;
@@ -338,8 +342,8 @@ class SearchTree {
     }
 
     template<typename... Args>
-    [[maybe_unused]] ArcID addArc ( NodeID const source_, NodeID const target_, Args &&... args_ ) noexcept {
-        ArcID id{ static_cast<typename ArcID::value_type> ( m_arcs.size ( ) ) };
+    [[maybe_unused]] ArcID addArc ( NodeID const source_, NodeID const target_, Args &&... args_ ) {
+        ArcID const id = checked_id<ArcID> ( m_arcs.size ( ) );
         m_arcs.emplace_back ( source_, target_, std::forward<Args> ( args_ )... );
         if ( ArcID::invalid ( ) == m_nodes[ source_.value ].head_out )
             m_nodes[ source_.value ].tail_out = m_nodes[ source_.value ].head_out = id;
@@ -362,13 +366,100 @@ class SearchTree {
 
     // Add node, after checking it's not already added with NodeID contains ( Hash ).
     template<typename... Args>
-    [[maybe_unused]] NodeID addNode ( Hash && hash_, Args &&... args_ ) noexcept {
-        NodeID id{ static_cast<typename NodeID::value_type> ( m_nodes.size ( ) ) };
-        m_nodes.emplace_back ( std::forward<Args> ( args_ )... );
+    [[maybe_unused]] NodeID addNode ( Hash && hash_, Args &&... args_ ) {
+        NodeID const id = checked_id<NodeID> ( m_nodes.size ( ) );
+        m_nodes.emplace_back ( hash_, std::forward<Args> ( args_ )... );
         m_trans.emplace ( std::move ( hash_ ), id );
         return id;
     }
 
+    // Add count_ children to source_ in one step, generator_ ( i ) returns the hash, the arc data and the node data of
+    // the i-th child (a tuple or a struct of the three). A child with a known hash is a transposition, its arc links to
+    // the existing node. The arcs and the new nodes are appended contiguously and the out-list of source_ is spliced
+    // once. Returns the first arc, the arcs are [ first, first + count_ ).
+    template<typename Generator>
+    [[maybe_unused]] ArcID addChildren ( NodeID const source_, std::size_t const count_, Generator && generator_ ) {
+        if ( not count_ )
+            return ArcID::invalid ( );
+        ArcID const first = checked_id<ArcID> ( m_arcs.size ( ) ), last = checked_id<ArcID> ( m_arcs.size ( ) + count_ - 1 );
+        [[maybe_unused]] NodeID const last_target = checked_id<NodeID> ( m_nodes.size ( ) + count_ - 1 );
+        reserve_more ( m_arcs, count_ );
+        reserve_more ( m_nodes, count_ );
+        for ( std::size_t i = 0; i < count_; ++i ) {
+            auto && [ hash, arc_data, node_data ] = generator_ ( i );
+            ArcID const id{ first.value + i };
+            NodeID target = contains ( hash );
+            if ( NodeID::invalid ( ) == target ) {
+                target      = NodeID{ m_nodes.size ( ) };
+                Node & node = m_nodes.emplace_back ( hash, std::move ( node_data ) );
+                node.head_in = node.tail_in = id;
+                node.in_size                = 1;
+                m_trans.emplace ( hash, target );
+            }
+            else {
+                Node & node = m_nodes[ target.value ]; // Possibly added by addNode and not linked yet, as in addArc.
+                if ( ArcID::invalid ( ) == node.head_in )
+                    node.tail_in = node.head_in = id;
+                else
+                    node.tail_in = m_arcs[ node.tail_in.value ].next_in = id;
+                ++node.in_size;
+            }
+            m_arcs.emplace_back ( source_, target, std::move ( arc_data ) ).next_out =
+                id != last ? ArcID{ id.value + 1 } : ArcID::invalid ( );
+        }
+        Node & source = m_nodes[ source_.value ];
+        if ( ArcID::invalid ( ) == source.head_out )
+            source.head_out = first;
+        else
+            m_arcs[ source.tail_out.value ].next_out = first;
+        source.tail_out = last;
+        source.out_size += static_cast<IdType> ( count_ );
+        return first;
+    }
+
+    // The backups of the DAG. A node reached through transpositions has several parents, either the statistics follow
+    // the path of the playout (a transposition shares its statistics, its parents do not see the playouts through the
+    // other parents), or they go to all ancestors of the leaf, each ancestor once.
+
+    // Backup along path_ (the descent, the root first), the last link first: update_ ( data, value ) is applied to the
+    // target of every link, the return value, if any, goes to the target of the link before, see apply_update.
+    template<typename Value, typename Update>
+    void backpropagate ( Path const & path_, Value value_, Update && update_ ) {
+        for ( auto it = path_.cend ( ); it != path_.cbegin ( ); ) {
+            --it;
+            apply_update ( update_, m_nodes[ it->target.value ].data, value_ );
+        }
+    }
+
+    // The scratch of the backup to all ancestors, keep one (per thread) and pass it to every call, the marks of the
+    // ancestors seen are reset in O ( 1 ) per call.
+    template<typename Value>
+    struct BackupScratch {
+        EpochMarks marks;
+        std::vector<std::pair<NodeID, Value>> queue;
+    };
+
+    // Backup from leaf_ to all its ancestors, every node once, whatever the number of paths to it: breadth first along
+    // the in-arcs, the nodes nearer to leaf_ first. A node gets the value of the first of its children that got to it.
+    // The cost is proportional to the number of ancestors of leaf_ (and their in-arcs), not to the size of the tree.
+    template<typename Value, typename Update>
+    void backpropagate ( NodeID const leaf_, Value value_, Update && update_, BackupScratch<Value> & scratch_ ) {
+        scratch_.marks.next ( m_nodes.size ( ) );
+        scratch_.queue.clear ( );
+        scratch_.marks.mark ( leaf_.value );
+        scratch_.queue.emplace_back ( leaf_, std::move ( value_ ) );
+        for ( std::size_t i = 0; i < scratch_.queue.size ( ); ++i ) { // By index, the queue grows.
+            NodeID const node = scratch_.queue[ i ].first;
+            Value value       = scratch_.queue[ i ].second;
+            apply_update ( update_, m_nodes[ node.value ].data, value );
+            for ( ArcID in = m_nodes[ node.value ].head_in; ArcID::invalid ( ) != in; in = m_arcs[ in.value ].next_in ) {
+                NodeID const parent = m_arcs[ in.value ].source; // Invalid (the admin node) for the root arc.
+                if ( NodeID::invalid ( ) != parent and scratch_.marks.mark ( parent.value ) )
+                    scratch_.queue.emplace_back ( parent, value );
+            }
+        }
+    }
+
     class node_iterator {
 
         friend class SearchTree;
@@ -634,8 +725,8 @@ class SearchTree {
     [[nodiscard]] bool isLeaf ( NodeID const node_ ) const noexcept { return not m_nodes[ node_.value ].out_size; }
     [[nodiscard]] bool isInternal ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].out_size; }
 
-    [[nodiscard]] Int inArcNum ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].in_size; }
-    [[nodiscard]] Int outArcNum ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].out_size; }
+    [[nodiscard]] IdType inArcNum ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].in_size; }
+    [[nodiscard]] IdType outArcNum ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].out_size; }
 
     [[nodiscard]] bool hasInArc ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].in_size; }
     [[nodiscard]] bool hasOutArc ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].out_size; }
@@ -664,135 +755,99 @@ class SearchTree {
     // The number of valid arcs. This is not the same as the size of
     // the arcs-vector, which allows for some additional admin elements,
     // use arcsSize ( ) instead.
-    [[nodiscard]] Int arcNum ( ) const noexcept { return static_cast<Int> ( m_arcs.size ( ) ) - 2; }
+    [[nodiscard]] IdType arcNum ( ) const noexcept { return static_cast<IdType> ( m_arcs.size ( ) ) - 2; }
     // The number of valid nodes. This is not the same as the size of
     // the arcs-vector, which allows for some additional admin elements,
     // use nodesSize ( ) instead.
-    [[nodiscard]] Int nodeNum ( ) const noexcept { return static_cast<Int> ( m_nodes.size ( ) ) - 1; }
+    [[nodiscard]] IdType nodeNum ( ) const noexcept { return static_cast<IdType> ( m_nodes.size ( ) ) - 1; }
 
     // The size of the arcs-vector (allows for some admin elements).
     [[nodiscard]] std::size_t arcsSize ( ) const noexcept { return m_arcs.size ( ); }
     // The size of the nodes-vector (allows for some admin elements).
     [[nodiscard]] std::size_t nodesSize ( ) const noexcept { return m_nodes.size ( ); }
 
-    // Destructively construct a sub-tree out of the current tree [Depth First].
+    // Depth and branching histograms, leaves and memory use (slack included), in one pass over the flat vectors.
+    [[nodiscard]] TreeProfile profile ( ) const { return TreeProfile::of ( *this ); }
+
+    // Destructively construct a sub-tree out of the current tree [Breadth First]. The children of a node are
+    // discovered together, they get contiguous ids and keep their order.
     [[nodiscard]] SearchTree makeSubTree ( NodeID const root_node_to_be_ ) {
         assert ( NodeID::invalid ( ) != root_node_to_be_ );
         assert ( root_node != root_node_to_be_ );
-        SearchTree sub_tree{ std::move ( m_nodes[ root_node_to_be_.value ].data ) };
-        // The Visited-vector stores the new NodeID's indexed by old NodeID's,
-        // old NodeID's not present in the new tree have a value of NodeID::invalid ( ).
-        static Visited visited;
-        visited.clear ( );
-        visited.resize ( m_nodes.size ( ), NodeID::invalid ( ) );
-        visited[ root_node_to_be_.value ] = sub_tree.root_node;
-        static Stack stack;
-        stack.clear ( );
-        stack.push_back ( root_node_to_be_ );
-        while ( stack.size ( ) ) {
-            NodeID const parent = stack.back ( );
-            stack.pop_back ( );
-            for ( ArcID a = m_nodes[ parent.value ].head_out; ArcID::invalid ( ) != a; a = m_arcs[ a.value ].next_out ) {
-                NodeID const child{ m_arcs[ a.value ].target };
-                if ( NodeID::invalid ( ) == visited[ child.value ] ) { // Not visited yet.
-                    visited[ child.value ] = sub_tree.addNode ( std::move ( m_nodes[ child.value ].data ) );
-                    stack.push_back ( child );
-                }
-                sub_tree.addArc ( visited[ parent.value ], visited[ child.value ], std::move ( m_arcs[ a.value ].data ) );
+        // A visitor of the breadth first traversal, a node is copied when it is discovered, an arc when it is scanned.
+        struct Copy : trv::Visitor {
+            SearchTree & tree;
+            SearchTree sub_tree;
+            // The Visited-vector stores the new NodeID's indexed by old NodeID's,
+            // old NodeID's not present in the new tree have a value of NodeID::invalid ( ).
+            Visited visited;
+
+            trv::Visit arc ( NodeID const source_, ArcID const arc_, NodeID const target_, bool const first_ ) {
+                if ( first_ )
+                    visited[ target_.value ] = sub_tree.addNode ( Hash{ tree.m_nodes[ target_.value ].hash },
+                                                                std::move ( tree.m_nodes[ target_.value ].data ) );
+                sub_tree.addArc ( visited[ source_.value ], visited[ target_.value ],
+                                  std::move ( tree.m_arcs[ arc_.value ].data ) );
+                return trv::Visit::proceed;
             }
-        }
-        return sub_tree;
+        };
+        Copy copy{ { }, *this, SearchTree{ std::move ( m_nodes[ root_node_to_be_.value ].data ) },
+                   Visited ( m_nodes.size ( ), NodeID::invalid ( ) ) };
+        copy.visited[ root_node_to_be_.value ] = copy.sub_tree.root_node;
+        trv::Scratch<SearchTree> scratch;
+        trv::breadthFirst ( *this, root_node_to_be_, copy, scratch );
+        m_generation.bump ( ); // The data was moved out.
+        return std::move ( copy.sub_tree );
     }
 
-    void traverseBreadthFirst ( NodeID const root_node_to_be_ = NodeID{ 1 } ) { // Default is to walk the whole tree.
-        assert ( NodeID::invalid ( ) != root_node_to_be_ );
-        // The Visited-vector stores the new NodeID's indexed by old NodeID's,
-        // old NodeID's not present in the new tree have a value of NodeID::invalid ( ).
-        static std::vector<bool> visited;
-        visited.clear ( );
-        visited.resize ( m_nodes.size ( ), false );
-        visited[ root_node_to_be_.value ] = true;
-        static Queue queue;
-        queue.clear ( );
-        queue.push_back ( root_node_to_be_ );
-        while ( queue.size ( ) ) {
-            NodeID const parent = queue.front ( );
-            queue.pop_front ( );
-            for ( ArcID a = m_nodes[ parent.value ].head_out; ArcID::invalid ( ) != a; a = m_arcs[ a.value ].next_out ) {
-                NodeID child{ m_arcs[ a.value ].target };
-                if ( not visited[ child.value ] ) { // Not visited yet.
-                    visited[ child.value ] = true;
-                    queue.emplace_back ( std::move ( child ) );
-                    // All nodes traversed once here.
-                }
-                // All arcs traversed once here [nodes are traversed (possibly) several times].
-            }
-        }
+    // Walk the tree from root_ breadth first (depth first), reporting to visitor_, see trv::breadthFirst (depthFirst).
+    // Returns false if the visitor stopped the walk. Pass a scratch (and keep it) for walks that do not allocate.
+    template<typename Visitor>
+    [[maybe_unused]] bool traverseBreadthFirst ( NodeID const root_, Visitor && visitor_,
+                                                     trv::Scratch<SearchTree> & scratch_ ) const {
+        return trv::breadthFirst ( *this, root_, std::forward<Visitor> ( visitor_ ), scratch_ );
+    }
+    template<typename Visitor = trv::Visitor>
+    [[maybe_unused]] bool traverseBreadthFirst ( NodeID const root_ = NodeID{ 1 }, Visitor && visitor_ = Visitor{ } ) const {
+        trv::Scratch<SearchTree> scratch;
+        return trv::breadthFirst ( *this, root_, std::forward<Visitor> ( visitor_ ), scratch );
     }
 
-    void traverseDepthFirst ( NodeID const root_node_to_be_ = NodeID{ 1 } ) { // Default is to walk the whole tree.
-        assert ( NodeID::invalid ( ) != root_node_to_be_ );
-        // The Visited-vector stores the new NodeID's indexed by old NodeID's,
-        // old NodeID's not present in the new tree have a value of NodeID::invalid ( ).
-        static std::vector<bool> visited;
-        visited.clear ( );
-        visited.resize ( m_nodes.size ( ), false );
-        visited[ root_node_to_be_.value ] = true;
-        static Stack stack;
-        stack.clear ( );
-        stack.push_back ( root_node_to_be_ );
-        while ( stack.size ( ) ) {
-            NodeID const parent = stack.back ( );
-            stack.pop_back ( );
-            for ( ArcID a = m_nodes[ parent.value ].head_out; ArcID::invalid ( ) != a; a = m_arcs[ a.value ].next_out ) {
-                NodeID child{ m_arcs[ a.value ].target };
-                if ( not visited[ child.value ] ) { // Not visited yet.
-                    visited[ child.value ] = true;
-                    stack.emplace_back ( std::move ( child ) );
-                }
-            }
-        }
+    template<typename Visitor>
+    [[maybe_unused]] bool traverseDepthFirst ( NodeID const root_, Visitor && visitor_,
+                                                   trv::Scratch<SearchTree> & scratch_ ) const {
+        return trv::depthFirst ( *this, root_, std::forward<Visitor> ( visitor_ ), scratch_ );
+    }
+    template<typename Visitor = trv::Visitor>
+    [[maybe_unused]] bool traverseDepthFirst ( NodeID const root_ = NodeID{ 1 }, Visitor && visitor_ = Visitor{ } ) const {
+        trv::Scratch<SearchTree> scratch;
+        return trv::depthFirst ( *this, root_, std::forward<Visitor> ( visitor_ ), scratch );
     }
 
-    // Topological sorting, using Kahn's alogorithm (does not traverse all arcs).
-    [[nodiscard]] std::vector<NodeID> topologicalSort ( ) const noexcept {
+    // Topological sorting, using Kahn's algorithm, in O ( nodes + arcs ), see trv::topologicalSort. If layers_, the
+    // start of every layer (plus the end of the last one) is appended to it.
+    [[nodiscard]] std::vector<NodeID> topologicalSort ( std::vector<std::size_t> * const layers_ = nullptr ) const {
         std::vector<NodeID> sorted;
-        static std::vector<bool> removed_arcs;
-        removed_arcs.clear ( );
-        removed_arcs.resize ( m_arcs.size ( ), false );
-        static Stack stack;
-        stack.clear ( );
-        stack.push_back ( root_node );
-        while ( stack.size ( ) ) {
-            sorted.push_back ( stack.back ( ) );
-            stack.pop_back ( );
-            for ( ArcID out = m_nodes[ sorted.back ( ).value ].head_out; ArcID::invalid ( ) != out;
-                  out       = m_arcs[ out.value ].next_out ) {
-                removed_arcs[ out.value ] = true;
-                bool has_no_in_arcs       = true;
-                for ( ArcID in = m_nodes[ m_arcs[ out.value ].target.value ].head_in; ArcID::invalid ( ) != in;
-                      in       = m_arcs[ in.value ].next_in ) {
-                    if ( not removed_arcs[ in.value ] ) {
-                        has_no_in_arcs = false;
-                        break;
-                    }
-                }
-                if ( has_no_in_arcs )
-                    stack.push_back ( m_arcs[ out.value ].target );
-            }
-        }
+        trv::Scratch<SearchTree> scratch;
+        trv::topologicalSort ( *this, root_node, sorted, layers_, scratch );
         return sorted;
     }
 
+    // See Generation, changes when the ids of the tree go stale.
+    [[nodiscard]] std::uint64_t generation ( ) const noexcept { return m_generation.value ( ); }
+
     // Data members.
 
     ArcID root_arc;
     NodeID root_node;
 
     private:
+    friend class ::tree_access;
+
     Arcs m_arcs;
     Nodes m_nodes;
     Trans m_trans; // Transpositions.
+    Generation m_generation;
 };
 
 } // namespace fsth
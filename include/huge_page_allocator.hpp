@@ -0,0 +1,162 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#if defined( _WIN32 )
+#    ifndef NOGDI
+#        define NOGDI // Otherwise Arc is defined.
+#    endif
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <Windows.h>
+#else
+#    include <sys/mman.h>
+#endif
+
+// An allocator for the flat vectors of the trees, f.e. fst::SearchTree<ArcData, NodeData, hpa::huge_page_allocator>, that
+// backs every allocation of a huge page or more with 2 MiB pages, so that a walk over tens of GB of nodes and arcs
+// needs a fraction of the TLB entries. Smaller allocations (a young tree) go to std::allocator.
+//
+// On Linux an explicit MAP_HUGETLB mapping is tried first, this needs pages reserved in /proc/sys/vm/nr_hugepages,
+// after the first failure it is not tried again. Otherwise a reservation aligned to 2 MiB is advised with
+// MADV_HUGEPAGE, which is honoured if /sys/kernel/mm/transparent_hugepage/enabled is [always] or [madvise]. On Windows
+// large pages are tried (which needs the SeLockMemoryPrivilege), with a fall back to plain pages.
+
+namespace hpa {
+
+inline constexpr std::size_t huge_page_size = std::size_t{ 1 } << 21;
+
+namespace detail {
+
+[[nodiscard]] constexpr std::size_t huge_page_round ( std::size_t const bytes_ ) noexcept {
+    return ( bytes_ + huge_page_size - 1 ) & ~( huge_page_size - 1 );
+}
+
+// bytes_ is a multiple of huge_page_size.
+[[nodiscard]] inline void * huge_page_allocate ( std::size_t const bytes_ ) {
+#if defined( _WIN32 )
+    static std::atomic<bool> large_pages{ GetLargePageMinimum ( ) and not( huge_page_size % GetLargePageMinimum ( ) ) };
+    if ( large_pages.load ( std::memory_order_relaxed ) ) {
+        if ( void * p = VirtualAlloc ( nullptr, bytes_, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE ) )
+            return p;
+        large_pages.store ( false, std::memory_order_relaxed );
+    }
+    if ( void * p = VirtualAlloc ( nullptr, bytes_, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE ) )
+        return p;
+    throw std::bad_alloc ( );
+#else
+#    if defined( MAP_HUGETLB )
+    static std::atomic<bool> hugetlb{ true };
+    if ( hugetlb.load ( std::memory_order_relaxed ) ) {
+        void * p = ::mmap ( nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+        if ( MAP_FAILED != p )
+            return p;
+        hugetlb.store ( false, std::memory_order_relaxed );
+    }
+#    endif
+    // Reserve a huge page more than needed, and give back what is not aligned.
+    std::size_t const reserved = bytes_ + huge_page_size;
+    void * const r             = ::mmap ( nullptr, reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( MAP_FAILED == r )
+        throw std::bad_alloc ( );
+    char * const first = static_cast<char *> ( r );
+    char * const p = reinterpret_cast<char *> ( huge_page_round ( reinterpret_cast<std::uintptr_t> ( first ) ) );
+    if ( p != first )
+        ::munmap ( first, p - first );
+    if ( std::size_t const tail = ( first + reserved ) - ( p + bytes_ ) )
+        ::munmap ( p + bytes_, tail );
+#    if defined( MADV_HUGEPAGE )
+    ::madvise ( p, bytes_, MADV_HUGEPAGE );
+#    endif
+    return p;
+#endif
+}
+
+inline void huge_page_deallocate ( void * const p_, [[maybe_unused]] std::size_t const bytes_ ) noexcept {
+#if defined( _WIN32 )
+    VirtualFree ( p_, 0, MEM_RELEASE );
+#else
+    ::munmap ( p_, bytes_ );
+#endif
+}
+
+} // namespace detail
+
+template<typename Type>
+class huge_page_allocator {
+
+    [[nodiscard]] static constexpr bool is_huge ( std::size_t const n_ ) noexcept { return n_ * sizeof ( Type ) >= huge_page_size; }
+
+    public:
+    using value_type      = Type;
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    using propagate_on_container_move_assignment = std::true_type;
+    using is_always_equal                        = std::true_type;
+
+    template<typename Other>
+    struct rebind {
+        using other = huge_page_allocator<Other>;
+    };
+
+    constexpr huge_page_allocator ( ) noexcept {}
+    template<typename Other>
+    constexpr huge_page_allocator ( huge_page_allocator<Other> const & ) noexcept {}
+
+    [[nodiscard]] Type * allocate ( std::size_t const n_ ) {
+        static_assert ( alignof ( Type ) <= huge_page_size, "over-aligned type" );
+        if ( not is_huge ( n_ ) )
+            return std::allocator<Type>{ }.allocate ( n_ );
+        return static_cast<Type *> ( detail::huge_page_allocate ( detail::huge_page_round ( n_ * sizeof ( Type ) ) ) );
+    }
+
+    void deallocate ( Type * const p_, std::size_t const n_ ) noexcept {
+        if ( not is_huge ( n_ ) )
+            std::allocator<Type>{ }.deallocate ( p_, n_ );
+        else
+            detail::huge_page_deallocate ( p_, detail::huge_page_round ( n_ * sizeof ( Type ) ) );
+    }
+
+    template<typename Other>
+    [[nodiscard]] constexpr bool operator== ( huge_page_allocator<Other> const & ) const noexcept {
+        return true;
+    }
+    template<typename Other>
+    [[nodiscard]] constexpr bool operator!= ( huge_page_allocator<Other> const & ) const noexcept {
+        return false;
+    }
+};
+
+} // namespace hpa
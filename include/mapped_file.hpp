@@ -0,0 +1,155 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined( _WIN32 )
+#    ifndef NOGDI
+#        define NOGDI // Otherwise Arc is defined.
+#    endif
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <Windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+// A read-only memory-mapped file, the pages are faulted in on first access,
+// i.e. opening is (near) instantaneous, independent of the size of the file.
+class MappedFile {
+
+    std::byte const * m_data = nullptr;
+    std::size_t m_size       = 0;
+#if defined( _WIN32 )
+    HANDLE m_file = INVALID_HANDLE_VALUE, m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+
+    public:
+    MappedFile ( ) noexcept {}
+    explicit MappedFile ( std::filesystem::path const & path_ ) {
+#if defined( _WIN32 )
+        m_file =
+            CreateFileW ( path_.c_str ( ), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+        if ( INVALID_HANDLE_VALUE == m_file )
+            throw std::runtime_error ( "MappedFile: cannot open " + path_.string ( ) );
+        LARGE_INTEGER size;
+        if ( not GetFileSizeEx ( m_file, &size ) ) {
+            close ( );
+            throw std::runtime_error ( "MappedFile: cannot stat " + path_.string ( ) );
+        }
+        m_size = static_cast<std::size_t> ( size.QuadPart );
+        if ( m_size ) {
+            m_mapping = CreateFileMappingW ( m_file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+            if ( nullptr == m_mapping ) {
+                close ( );
+                throw std::runtime_error ( "MappedFile: cannot map " + path_.string ( ) );
+            }
+            m_data = static_cast<std::byte const *> ( MapViewOfFile ( m_mapping, FILE_MAP_READ, 0, 0, 0 ) );
+            if ( nullptr == m_data ) {
+                close ( );
+                throw std::runtime_error ( "MappedFile: cannot map " + path_.string ( ) );
+            }
+        }
+#else
+        m_fd = ::open ( path_.c_str ( ), O_RDONLY );
+        if ( -1 == m_fd )
+            throw std::runtime_error ( "MappedFile: cannot open " + path_.string ( ) );
+        struct stat st;
+        if ( -1 == ::fstat ( m_fd, &st ) ) {
+            close ( );
+            throw std::runtime_error ( "MappedFile: cannot stat " + path_.string ( ) );
+        }
+        m_size = static_cast<std::size_t> ( st.st_size );
+        if ( m_size ) {
+            void * p = ::mmap ( nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0 );
+            if ( MAP_FAILED == p ) {
+                close ( );
+                throw std::runtime_error ( "MappedFile: cannot map " + path_.string ( ) );
+            }
+            m_data = static_cast<std::byte const *> ( p );
+        }
+#endif
+    }
+
+    MappedFile ( MappedFile const & ) = delete;
+    MappedFile ( MappedFile && other_ ) noexcept { swap ( other_ ); }
+
+    ~MappedFile ( ) noexcept { close ( ); }
+
+    MappedFile & operator= ( MappedFile const & ) = delete;
+    [[maybe_unused]] MappedFile & operator= ( MappedFile && rhs_ ) noexcept {
+        MappedFile tmp{ std::move ( rhs_ ) };
+        swap ( tmp );
+        return *this;
+    }
+
+    void swap ( MappedFile & other_ ) noexcept {
+        std::swap ( m_data, other_.m_data );
+        std::swap ( m_size, other_.m_size );
+#if defined( _WIN32 )
+        std::swap ( m_file, other_.m_file );
+        std::swap ( m_mapping, other_.m_mapping );
+#else
+        std::swap ( m_fd, other_.m_fd );
+#endif
+    }
+
+    [[nodiscard]] std::byte const * data ( ) const noexcept { return m_data; }
+    [[nodiscard]] std::size_t size ( ) const noexcept { return m_size; }
+
+    private:
+    void close ( ) noexcept {
+#if defined( _WIN32 )
+        if ( m_data )
+            UnmapViewOfFile ( m_data );
+        if ( m_mapping )
+            CloseHandle ( m_mapping );
+        if ( INVALID_HANDLE_VALUE != m_file )
+            CloseHandle ( m_file );
+        m_mapping = nullptr, m_file = INVALID_HANDLE_VALUE;
+#else
+        if ( m_data )
+            ::munmap ( const_cast<std::byte *> ( m_data ), m_size );
+        if ( -1 != m_fd )
+            ::close ( m_fd );
+        m_fd = -1;
+#endif
+        m_data = nullptr, m_size = 0;
+    }
+};
@@ -0,0 +1,335 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "types.hpp"
+#include "link.hpp"
+#include "mapped_file.hpp"
+#include "tree_access.hpp"
+
+// A read-only snapshot of a fst- or fsth-tree, stored as a flat image on disk:
+//
+//     [ header | arc block | node block | transposition block (fsth only) ]
+//
+// the arc- and node blocks are verbatim copies of the m_arcs- and m_nodes-vectors
+// (admin elements included, so the ID's are unchanged), the transposition block is
+// a hash-sorted array. A SearchTreeView maps the image and queries it in place,
+// opening a snapshot costs (near) nothing, independent of the size of the tree.
+
+namespace mst {
+
+inline constexpr std::uint64_t snapshot_magic   = 0x50414E535354434Dull; // "MCTSSNAP".
+inline constexpr std::uint32_t snapshot_version = 1u;
+
+struct SnapshotHeader { // 96
+
+    std::uint64_t magic;
+    std::uint32_t version, id_size;                      // sizeof ( NodeID ), the id type of the tree.
+    std::uint32_t arc_size, node_size;                   // sizeof ( Arc ), sizeof ( Node ), a layout check.
+    std::uint64_t arc_num, node_num, trans_num;          // Elements per block (including the admin elements).
+    std::uint64_t arc_offset, node_offset, trans_offset; // In bytes, from the start of the image.
+    std::int64_t root_arc, root_node;
+};
+
+template<typename Tree>
+struct TransEntry {
+    std::uint64_t hash;
+    typename Tree::NodeID node;
+};
+
+namespace detail {
+
+inline constexpr std::uint64_t block_alignment = 64u;
+
+[[nodiscard]] constexpr std::uint64_t align ( std::uint64_t const offset_ ) noexcept {
+    return ( offset_ + block_alignment - 1u ) & ~( block_alignment - 1u );
+}
+
+template<typename Tree>
+void check_layout ( ) noexcept {
+    static_assert ( tree_access::has_arcs<Tree>, "snapshots are supported for fst and fsth only" );
+    // The blocks are memory images, written and read as raw bytes, the data cannot own any resources.
+    static_assert ( std::is_trivially_copyable<typename Tree::Arc>::value, "arc data should be trivially copyable" );
+    static_assert ( std::is_trivially_copyable<typename Tree::Node>::value, "node data should be trivially copyable" );
+}
+
+inline void pad ( std::ostream & out_, std::uint64_t const offset_ ) {
+    static char const zeros[ block_alignment ] = { };
+    out_.write ( zeros, static_cast<std::streamsize> ( align ( offset_ ) - offset_ ) );
+}
+
+} // namespace detail
+
+template<typename Tree>
+void saveSnapshot ( Tree const & tree_, std::filesystem::path const & path_ ) {
+    detail::check_layout<Tree> ( );
+    using Arc  = typename Tree::Arc;
+    using Node = typename Tree::Node;
+    auto const & arcs  = tree_access::arcs ( tree_ );
+    auto const & nodes = tree_access::nodes ( tree_ );
+    std::vector<TransEntry<Tree>> trans;
+    if constexpr ( tree_access::has_transpositions<Tree> ) {
+        static_assert ( sizeof ( typename Tree::Trans::key_type ) == sizeof ( std::uint64_t ), "64-bit hashes expected" );
+        auto const & t = tree_access::transpositions ( tree_ );
+        trans.reserve ( t.size ( ) );
+        for ( auto const & e : t )
+            trans.push_back ( { e.first, e.second } );
+        std::sort ( trans.begin ( ), trans.end ( ),
+                    [] ( TransEntry<Tree> const & a_, TransEntry<Tree> const & b_ ) { return a_.hash < b_.hash; } );
+    }
+    SnapshotHeader header{ };
+    header.magic        = snapshot_magic;
+    header.version      = snapshot_version;
+    header.id_size      = sizeof ( typename Tree::NodeID );
+    header.arc_size     = sizeof ( Arc );
+    header.node_size    = sizeof ( Node );
+    header.arc_num      = arcs.size ( );
+    header.node_num     = nodes.size ( );
+    header.trans_num    = trans.size ( );
+    header.arc_offset   = detail::align ( sizeof ( SnapshotHeader ) );
+    header.node_offset  = detail::align ( header.arc_offset + header.arc_num * sizeof ( Arc ) );
+    header.trans_offset = detail::align ( header.node_offset + header.node_num * sizeof ( Node ) );
+    header.root_arc     = tree_.root_arc.value;
+    header.root_node    = tree_.root_node.value;
+    std::ofstream out ( path_, std::ios::binary | std::ios::trunc );
+    if ( not out )
+        throw std::runtime_error ( "saveSnapshot: cannot open " + path_.string ( ) );
+    out.write ( reinterpret_cast<char const *> ( &header ), sizeof ( SnapshotHeader ) );
+    detail::pad ( out, sizeof ( SnapshotHeader ) );
+    out.write ( reinterpret_cast<char const *> ( arcs.data ( ) ),
+                static_cast<std::streamsize> ( header.arc_num * sizeof ( Arc ) ) );
+    detail::pad ( out, header.arc_offset + header.arc_num * sizeof ( Arc ) );
+    out.write ( reinterpret_cast<char const *> ( nodes.data ( ) ),
+                static_cast<std::streamsize> ( header.node_num * sizeof ( Node ) ) );
+    detail::pad ( out, header.node_offset + header.node_num * sizeof ( Node ) );
+    out.write ( reinterpret_cast<char const *> ( trans.data ( ) ),
+                static_cast<std::streamsize> ( header.trans_num * sizeof ( TransEntry<Tree> ) ) );
+    if ( not out )
+        throw std::runtime_error ( "saveSnapshot: cannot write " + path_.string ( ) );
+}
+
+template<typename Tree>
+class SearchTreeView {
+
+    public:
+    using ArcID        = typename Tree::ArcID;
+    using NodeID       = typename Tree::NodeID;
+    using Arc          = typename Tree::Arc;
+    using Node         = typename Tree::Node;
+    using ArcData      = typename Arc::data_type;
+    using NodeData     = typename Node::data_type;
+    using size_type    = typename NodeID::value_type;
+    using Link         = Link<SearchTreeView>;
+    using OptionalLink = OptionalLink<SearchTreeView>;
+
+    // Map the snapshot at path_.
+    explicit SearchTreeView ( std::filesystem::path const & path_ ) : m_file{ path_ } {
+        attach ( m_file.data ( ), m_file.size ( ) );
+    }
+    // View a snapshot image in memory, the image should outlive the view.
+    SearchTreeView ( std::byte const * data_, std::size_t const size_ ) { attach ( data_, size_ ); }
+
+    class const_in_iterator {
+
+        friend class SearchTreeView;
+
+        SearchTreeView const & m_st;
+        ArcID m_id;
+
+        public:
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = Arc;
+        using reference         = Arc const &;
+        using pointer           = Arc const *;
+        using const_reference   = Arc const &;
+        using const_pointer     = Arc const *;
+        using iterator_category = std::forward_iterator_tag;
+
+        const_in_iterator ( SearchTreeView const & tree_, NodeID const node_ ) noexcept :
+            m_st{ tree_ }, m_id{ tree_access::head_in ( m_st.m_nodes[ node_.value ] ) } {}
+
+        [[nodiscard]] bool is_valid ( ) const noexcept { return ArcID::invalid ( ) != m_id; }
+
+        [[maybe_unused]] const_in_iterator & operator++ ( ) noexcept {
+            m_id = tree_access::next_in ( m_st.m_arcs[ m_id.value ] );
+            return *this;
+        }
+
+        [[nodiscard]] const_reference operator* ( ) const noexcept { return m_st.m_arcs[ m_id.value ]; }
+
+        [[nodiscard]] const_pointer operator-> ( ) const noexcept { return m_st.m_arcs + m_id.value; }
+
+        [[nodiscard]] ArcID id ( ) const noexcept { return m_id; }
+    };
+
+    class const_out_iterator {
+
+        friend class SearchTreeView;
+
+        SearchTreeView const & m_st;
+        ArcID m_id;
+
+        public:
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = Arc;
+        using reference         = Arc const &;
+        using pointer           = Arc const *;
+        using const_reference   = Arc const &;
+        using const_pointer     = Arc const *;
+        using iterator_category = std::forward_iterator_tag;
+
+        const_out_iterator ( SearchTreeView const & tree_, NodeID const node_ ) noexcept :
+            m_st{ tree_ }, m_id{ m_st.m_nodes[ node_.value ].head_out } {}
+
+        [[nodiscard]] bool is_valid ( ) const noexcept { return ArcID::invalid ( ) != m_id; }
+
+        [[maybe_unused]] const_out_iterator & operator++ ( ) noexcept {
+            m_id = m_st.m_arcs[ m_id.value ].next_out;
+            return *this;
+        }
+
+        [[nodiscard]] const_reference operator* ( ) const noexcept { return m_st.m_arcs[ m_id.value ]; }
+
+        [[nodiscard]] const_pointer operator-> ( ) const noexcept { return m_st.m_arcs + m_id.value; }
+
+        [[nodiscard]] ArcID id ( ) const noexcept { return m_id; }
+    };
+
+    [[nodiscard]] Link link ( ArcID const arc_ ) const noexcept { return { arc_, m_arcs[ arc_.value ].target }; }
+    [[nodiscard]] OptionalLink link ( NodeID const source_, NodeID const target_ ) const noexcept {
+        for ( const_in_iterator it = cbeginIn ( target_ ); it.is_valid ( ); ++it )
+            if ( source_ == it->source )
+                return { { it.id ( ), target_ } };
+        return { };
+    }
+    template<typename It>
+    [[nodiscard]] Link link ( It const & it_ ) const noexcept {
+        return { it_.id ( ), it_->target };
+    }
+
+    [[nodiscard]] bool isLeaf ( NodeID const node_ ) const noexcept { return not m_nodes[ node_.value ].out_size; }
+    [[nodiscard]] bool isInternal ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].out_size; }
+
+    [[nodiscard]] size_type inArcNum ( NodeID const node_ ) const noexcept {
+        return tree_access::in_size ( m_nodes[ node_.value ] );
+    }
+    [[nodiscard]] size_type outArcNum ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].out_size; }
+
+    [[nodiscard]] bool hasInArc ( NodeID const node_ ) const noexcept { return tree_access::in_size ( m_nodes[ node_.value ] ); }
+    [[nodiscard]] bool hasOutArc ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].out_size; }
+
+    [[nodiscard]] const_in_iterator beginIn ( NodeID const node_ ) const noexcept { return const_in_iterator{ *this, node_ }; }
+    [[nodiscard]] const_in_iterator cbeginIn ( NodeID const node_ ) const noexcept { return const_in_iterator{ *this, node_ }; }
+
+    [[nodiscard]] const_out_iterator beginOut ( NodeID const node_ ) const noexcept { return const_out_iterator{ *this, node_ }; }
+    [[nodiscard]] const_out_iterator cbeginOut ( NodeID const node_ ) const noexcept { return const_out_iterator{ *this, node_ }; }
+
+    template<typename AD = ArcData>
+    [[nodiscard]] std::enable_if_t<std::negation<std::is_void<AD>>::value, AD const &>
+    operator[] ( ArcID const arc_ ) const noexcept {
+        return tree_access::data ( m_arcs[ arc_.value ] );
+    }
+    [[nodiscard]] NodeData const & operator[] ( NodeID const node_ ) const noexcept { return m_nodes[ node_.value ].data; }
+
+    // A non-existing hash_ returns a NodeID::invalid ( ) (fsth only).
+    template<typename T = Tree>
+    [[nodiscard]] std::enable_if_t<tree_access::has_transpositions<T>, NodeID>
+    contains ( std::uint64_t const hash_ ) const noexcept {
+        TransEntry<Tree> const * it =
+            std::lower_bound ( m_trans, m_trans + m_trans_size, hash_,
+                               [] ( TransEntry<Tree> const & e_, std::uint64_t const h_ ) { return e_.hash < h_; } );
+        return m_trans + m_trans_size != it and hash_ == it->hash ? it->node : NodeID::invalid ( );
+    }
+
+    // The number of valid arcs, see fst::SearchTree.
+    [[nodiscard]] size_type arcNum ( ) const noexcept { return static_cast<size_type> ( m_arcs_size ) - 2; }
+    // The number of valid nodes, see fst::SearchTree.
+    [[nodiscard]] size_type nodeNum ( ) const noexcept { return static_cast<size_type> ( m_nodes_size ) - 1; }
+
+    // The size of the arcs-block (allows for some admin elements).
+    [[nodiscard]] std::size_t arcsSize ( ) const noexcept { return m_arcs_size; }
+    // The size of the nodes-block (allows for some admin elements).
+    [[nodiscard]] std::size_t nodesSize ( ) const noexcept { return m_nodes_size; }
+
+    // Data members.
+
+    ArcID root_arc;
+    NodeID root_node;
+
+    private:
+    void attach ( std::byte const * data_, std::size_t const size_ ) {
+        detail::check_layout<Tree> ( );
+        if ( size_ < sizeof ( SnapshotHeader ) )
+            throw std::runtime_error ( "SearchTreeView: truncated snapshot" );
+        SnapshotHeader const & header = *reinterpret_cast<SnapshotHeader const *> ( data_ );
+        if ( snapshot_magic != header.magic or snapshot_version != header.version )
+            throw std::runtime_error ( "SearchTreeView: not a snapshot" );
+        if ( sizeof ( NodeID ) != header.id_size or sizeof ( Arc ) != header.arc_size or sizeof ( Node ) != header.node_size )
+            throw std::runtime_error ( "SearchTreeView: snapshot layout does not match the tree type" );
+        // The blocks are aligned, in order and do not overlap, [ offset_, offset_ + num_ * size_ ) ends before end_.
+        auto const fits = [] ( std::uint64_t const offset_, std::uint64_t const num_, std::size_t const size_,
+                               std::uint64_t const end_ ) noexcept {
+            return not( offset_ % detail::block_alignment ) and offset_ <= end_ and num_ <= ( end_ - offset_ ) / size_;
+        };
+        if ( header.arc_offset < sizeof ( SnapshotHeader ) or size_ < header.trans_offset )
+            throw std::runtime_error ( "SearchTreeView: corrupt snapshot" );
+        if ( not fits ( header.trans_offset, header.trans_num, sizeof ( TransEntry<Tree> ), size_ ) )
+            throw std::runtime_error ( "SearchTreeView: truncated snapshot" );
+        if ( not fits ( header.arc_offset, header.arc_num, sizeof ( Arc ), header.node_offset ) or
+             not fits ( header.node_offset, header.node_num, sizeof ( Node ), header.trans_offset ) or
+             header.root_arc < 0 or static_cast<std::uint64_t> ( header.root_arc ) >= header.arc_num or header.root_node < 0 or
+             static_cast<std::uint64_t> ( header.root_node ) >= header.node_num )
+            throw std::runtime_error ( "SearchTreeView: corrupt snapshot" );
+        m_arcs       = reinterpret_cast<Arc const *> ( data_ + header.arc_offset );
+        m_nodes      = reinterpret_cast<Node const *> ( data_ + header.node_offset );
+        m_trans      = reinterpret_cast<TransEntry<Tree> const *> ( data_ + header.trans_offset );
+        m_arcs_size  = static_cast<std::size_t> ( header.arc_num );
+        m_nodes_size = static_cast<std::size_t> ( header.node_num );
+        m_trans_size = static_cast<std::size_t> ( header.trans_num );
+        root_arc     = ArcID{ header.root_arc };
+        root_node    = NodeID{ header.root_node };
+    }
+
+    MappedFile m_file;
+    Arc const * m_arcs                = nullptr;
+    Node const * m_nodes              = nullptr;
+    TransEntry<Tree> const * m_trans = nullptr;
+    std::size_t m_arcs_size = 0, m_nodes_size = 0, m_trans_size = 0;
+};
+
+} // namespace mst
@@ -0,0 +1,307 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined( _WIN32 )
+#    ifndef NOGDI
+#        define NOGDI // Otherwise Arc is defined.
+#    endif
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <Windows.h>
+#else
+#    include <pthread.h>
+#    include <sched.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif
+
+#include "huge_page_allocator.hpp"
+
+// NUMA placement of the flat trees and of the threads working on them, without libnuma. A tree grows wherever its
+// vectors are first touched, i.e. on the node of the thread that grows it; the allocators below place the nodes and
+// arcs explicitly instead, either interleaved over all nodes (a tree shared by the workers of all sockets, every worker
+// sees the same mix of local and remote lines), or on the node of the allocating thread (a tree per worker, or per
+// socket). Like hpa::huge_page_allocator, only allocations of a huge page or more are placed, and on huge pages.
+//
+// On a single-socket machine a Topology can be simulated, the CPUs are dealt out over a number of virtual nodes, which
+// map onto the real node(s) round robin, so the workers are pinned as they would be on a multi-socket machine (and the
+// code paths are the same), but all memory is local.
+
+namespace numa {
+
+namespace detail {
+
+// Parses a cpulist or nodelist, f.e. "0-3,8-11".
+[[nodiscard]] inline std::vector<int> parse_list ( std::string const & list_ ) {
+    std::vector<int> ids;
+    std::stringstream ranges ( list_ );
+    std::string range;
+    while ( std::getline ( ranges, range, ',' ) ) {
+        if ( range.empty ( ) or '\n' == range[ 0 ] )
+            continue;
+        std::size_t const dash = range.find ( '-' );
+        int const first        = std::atoi ( range.c_str ( ) );
+        int const last         = std::string::npos == dash ? first : std::atoi ( range.c_str ( ) + dash + 1 );
+        for ( int id = first; id <= last; ++id )
+            ids.push_back ( id );
+    }
+    return ids;
+}
+
+[[nodiscard]] inline std::string read_line ( char const * path_ ) {
+    std::ifstream in ( path_ );
+    std::string line;
+    std::getline ( in, line );
+    return line;
+}
+
+// The real node the allocations of this thread go to (see Topology::pin), -1 if not pinned.
+[[nodiscard]] inline int & thread_node ( ) noexcept {
+    thread_local int node = -1;
+    return node;
+}
+
+} // namespace detail
+
+// The nodes of the machine and their CPUs, or a simulation thereof.
+class Topology {
+
+    std::vector<std::vector<int>> m_cpus; // By (virtual) node.
+    std::vector<int> m_real;              // The real node by (virtual) node.
+    bool m_simulated = false;
+
+    public:
+    [[nodiscard]] static Topology detect ( ) {
+        Topology topology;
+#if defined( _WIN32 )
+        ULONG highest = 0;
+        GetNumaHighestNodeNumber ( &highest );
+        for ( USHORT node = 0; node <= highest; ++node ) {
+            GROUP_AFFINITY affinity{ };
+            if ( not GetNumaNodeProcessorMaskEx ( node, &affinity ) or not affinity.Mask )
+                continue;
+            std::vector<int> cpus;
+            for ( int bit = 0; bit < 64; ++bit )
+                if ( affinity.Mask & KAFFINITY{ 1 } << bit )
+                    cpus.push_back ( affinity.Group * 64 + bit );
+            topology.m_cpus.push_back ( std::move ( cpus ) );
+            topology.m_real.push_back ( node );
+        }
+#else
+        for ( int const node : detail::parse_list ( detail::read_line ( "/sys/devices/system/node/online" ) ) ) {
+            std::string const path = "/sys/devices/system/node/node" + std::to_string ( node ) + "/cpulist";
+            std::vector<int> cpus  = detail::parse_list ( detail::read_line ( path.c_str ( ) ) );
+            if ( cpus.empty ( ) ) // A memory-only node.
+                continue;
+            topology.m_cpus.push_back ( std::move ( cpus ) );
+            topology.m_real.push_back ( node );
+        }
+#endif
+        if ( topology.m_cpus.empty ( ) ) { // No NUMA information, one node.
+            topology.m_cpus.emplace_back ( );
+            for ( unsigned cpu = 0; cpu < std::max ( 1u, std::thread::hardware_concurrency ( ) ); ++cpu )
+                topology.m_cpus.back ( ).push_back ( static_cast<int> ( cpu ) );
+            topology.m_real.push_back ( 0 );
+        }
+        return topology;
+    }
+
+    // nodes_ virtual nodes, the CPUs of the machine dealt out in contiguous blocks (at least one CPU per node).
+    [[nodiscard]] static Topology simulate ( int const nodes_ ) {
+        assert ( nodes_ > 0 );
+        Topology const machine = detect ( );
+        std::vector<int> cpus;
+        for ( std::vector<int> const & node : machine.m_cpus )
+            cpus.insert ( std::end ( cpus ), std::begin ( node ), std::end ( node ) );
+        Topology topology;
+        topology.m_simulated = true;
+        for ( int node = 0; node < nodes_; ++node ) {
+            std::size_t const first = cpus.size ( ) * node / nodes_, last = cpus.size ( ) * ( node + 1 ) / nodes_;
+            topology.m_cpus.emplace_back ( std::begin ( cpus ) + first, std::begin ( cpus ) + std::max ( last, first + 1 ) );
+            if ( last <= first ) // Fewer CPUs than nodes, share.
+                topology.m_cpus.back ( ) = { cpus[ std::min ( first, cpus.size ( ) - 1 ) ] };
+            topology.m_real.push_back ( machine.m_real[ node % machine.m_real.size ( ) ] );
+        }
+        return topology;
+    }
+
+    [[nodiscard]] int nodes ( ) const noexcept { return static_cast<int> ( m_cpus.size ( ) ); }
+    [[nodiscard]] bool simulated ( ) const noexcept { return m_simulated; }
+    [[nodiscard]] std::vector<int> const & cpus ( int const node_ ) const noexcept { return m_cpus[ node_ ]; }
+    [[nodiscard]] int real ( int const node_ ) const noexcept { return m_real[ node_ ]; }
+
+    // Pins the calling thread to the CPUs of node_, and makes it the node of the local_allocator of this thread.
+    [[maybe_unused]] bool pin ( int const node_ ) const noexcept {
+        detail::thread_node ( ) = m_real[ node_ ];
+#if defined( _WIN32 )
+        GROUP_AFFINITY affinity{ };
+        affinity.Group = static_cast<WORD> ( m_cpus[ node_ ].front ( ) / 64 );
+        for ( int const cpu : m_cpus[ node_ ] )
+            if ( cpu / 64 == affinity.Group )
+                affinity.Mask |= KAFFINITY{ 1 } << ( cpu % 64 );
+        return SetThreadGroupAffinity ( GetCurrentThread ( ), &affinity, nullptr );
+#elif defined( __linux__ )
+        cpu_set_t set;
+        CPU_ZERO ( &set );
+        for ( int const cpu : m_cpus[ node_ ] )
+            CPU_SET ( cpu, &set );
+        return not pthread_setaffinity_np ( pthread_self ( ), sizeof ( set ), &set );
+#else
+        return false;
+#endif
+    }
+
+    [[nodiscard]] std::string str ( ) const {
+        std::string s = std::to_string ( nodes ( ) ) + ( m_simulated ? " simulated node(s):" : " node(s):" );
+        for ( int node = 0; node < nodes ( ); ++node )
+            s += " [" + std::to_string ( m_cpus[ node ].size ( ) ) + " cpus on node " + std::to_string ( m_real[ node ] ) + "]";
+        return s;
+    }
+};
+
+// The machine as detected, once.
+[[nodiscard]] inline Topology const & machine ( ) {
+    static Topology const topology = Topology::detect ( );
+    return topology;
+}
+
+enum class Placement : int { interleave, local };
+
+namespace detail {
+
+// bytes_ is a multiple of the huge page size.
+[[nodiscard]] inline void * allocate ( std::size_t const bytes_, Placement const placement_ ) {
+    int const node = thread_node ( );
+#if defined( _WIN32 )
+    // No interleave policy, the huge pages are committed node by node.
+    char * const p = static_cast<char *> ( VirtualAlloc ( nullptr, bytes_, MEM_RESERVE, PAGE_READWRITE ) );
+    if ( nullptr == p )
+        throw std::bad_alloc ( );
+    Topology const & topology = machine ( );
+    for ( std::size_t offset = 0, page = 0; offset < bytes_; offset += hpa::huge_page_size, ++page ) {
+        DWORD const preferred =
+            Placement::local == placement_ and node >= 0 ? node : topology.real ( static_cast<int> ( page % topology.nodes ( ) ) );
+        if ( not VirtualAllocExNuma ( GetCurrentProcess ( ), p + offset, hpa::huge_page_size, MEM_COMMIT, PAGE_READWRITE,
+                                      preferred ) ) {
+            VirtualFree ( p, 0, MEM_RELEASE );
+            throw std::bad_alloc ( );
+        }
+    }
+    return p;
+#else
+    void * const p = hpa::detail::huge_page_allocate ( bytes_ );
+#    if defined( __linux__ ) and defined( SYS_mbind )
+    // Before the first touch, the policy applies to the pages as they are faulted in. Failure (no NUMA support in the
+    // kernel) leaves the default, first touch.
+    constexpr int mpol_preferred = 1, mpol_interleave = 3;
+    unsigned long mask           = 0;
+    if ( Placement::local == placement_ ) {
+        if ( node >= 0 )
+            mask = 1ul << node;
+    }
+    else {
+        Topology const & topology = machine ( );
+        for ( int n = 0; n < topology.nodes ( ); ++n )
+            mask |= 1ul << topology.real ( n );
+    }
+    if ( mask )
+        ::syscall ( SYS_mbind, p, bytes_, Placement::local == placement_ ? mpol_preferred : mpol_interleave, &mask,
+                    sizeof ( mask ) * 8 + 1, 0u );
+#    endif
+    return p;
+#endif
+}
+
+} // namespace detail
+
+template<typename Type, Placement Place>
+class basic_allocator {
+
+    [[nodiscard]] static constexpr bool is_placed ( std::size_t const n_ ) noexcept {
+        return n_ * sizeof ( Type ) >= hpa::huge_page_size;
+    }
+
+    public:
+    using value_type      = Type;
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    using propagate_on_container_move_assignment = std::true_type;
+    using is_always_equal                        = std::true_type;
+
+    template<typename Other>
+    struct rebind {
+        using other = basic_allocator<Other, Place>;
+    };
+
+    constexpr basic_allocator ( ) noexcept {}
+    template<typename Other>
+    constexpr basic_allocator ( basic_allocator<Other, Place> const & ) noexcept {}
+
+    [[nodiscard]] Type * allocate ( std::size_t const n_ ) {
+        if ( not is_placed ( n_ ) )
+            return std::allocator<Type>{ }.allocate ( n_ );
+        return static_cast<Type *> ( detail::allocate ( hpa::detail::huge_page_round ( n_ * sizeof ( Type ) ), Place ) );
+    }
+
+    void deallocate ( Type * const p_, std::size_t const n_ ) noexcept {
+        if ( not is_placed ( n_ ) )
+            std::allocator<Type>{ }.deallocate ( p_, n_ );
+        else
+            hpa::detail::huge_page_deallocate ( p_, hpa::detail::huge_page_round ( n_ * sizeof ( Type ) ) );
+    }
+
+    template<typename Other>
+    [[nodiscard]] constexpr bool operator== ( basic_allocator<Other, Place> const & ) const noexcept {
+        return true;
+    }
+    template<typename Other>
+    [[nodiscard]] constexpr bool operator!= ( basic_allocator<Other, Place> const & ) const noexcept {
+        return false;
+    }
+};
+
+// F.e. fst::SearchTree<ArcData, NodeData, numa::interleaved_allocator>.
+template<typename Type>
+using interleaved_allocator = basic_allocator<Type, Placement::interleave>;
+// The node of the thread that allocates, as set by Topology::pin, first touch if the thread is not pinned.
+template<typename Type>
+using local_allocator = basic_allocator<Type, Placement::local>;
+
+} // namespace numa
@@ -0,0 +1,332 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+#include "tree_access.hpp"
+
+// Parallel traversals of an fst or fsth tree, for trees of hundreds of millions of nodes.
+//
+//  - breadthFirst, level-synchronous: the nodes of a level (the frontier) are split into a range per worker, a worker
+//    claims the targets of the out-arcs of its nodes in an atomic bitmap and collects the nodes it claimed, the next
+//    level is the concatenation of the collections of the workers (in the order of the workers, the offsets are a
+//    prefix sum of their sizes). Of a tree, the order is that of a sequential breadth first traversal, of a DAG (fsth)
+//    a transposition goes to the worker that claims it first.
+//  - makeSubTree, destructive, as SearchTree::makeSubTree, the new ids are the positions in the breadth first order, the
+//    first arc of a node follows from a prefix sum of the out-degrees, so that all nodes and arcs are moved into the
+//    (pre-sized) vectors of the new tree concurrently, the out-arcs of a node are contiguous in the new tree.
+//
+// The work is done by a ptrv::Pool, a fork-join pool that runs a job on all its workers, the calling thread included.
+// A level (a range of nodes) smaller than a grain is not split up.
+
+namespace ptrv {
+
+class Pool {
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake, m_done;
+    std::function<void ( std::size_t )> m_job;
+    std::uint64_t m_round   = 0;
+    std::size_t m_running   = 0;
+    bool m_stop             = false;
+
+    void work ( std::size_t const worker_ ) {
+        std::uint64_t round = 0;
+        std::unique_lock<std::mutex> lock ( m_mutex );
+        while ( true ) {
+            m_wake.wait ( lock, [ & ] { return m_stop or round != m_round; } );
+            if ( m_stop )
+                return;
+            round = m_round;
+            lock.unlock ( );
+            m_job ( worker_ );
+            lock.lock ( );
+            if ( not --m_running )
+                m_done.notify_one ( );
+        }
+    }
+
+    public:
+    // A pool of size_ workers, the calling thread of run is one of them.
+    explicit Pool ( std::size_t const size_ = std::max ( 1u, std::thread::hardware_concurrency ( ) ) ) {
+        m_threads.reserve ( size_ - 1 );
+        for ( std::size_t worker = 1; worker < size_; ++worker )
+            m_threads.emplace_back ( [ this, worker ] ( ) { work ( worker ); } );
+    }
+
+    Pool ( Pool const & ) = delete;
+    Pool & operator= ( Pool const & ) = delete;
+
+    ~Pool ( ) {
+        {
+            std::lock_guard<std::mutex> lock ( m_mutex );
+            m_stop = true;
+        }
+        m_wake.notify_all ( );
+        for ( std::thread & thread : m_threads )
+            thread.join ( );
+    }
+
+    [[nodiscard]] std::size_t size ( ) const noexcept { return m_threads.size ( ) + 1; }
+
+    // Calls job_ ( worker ) for all workers [ 0, size ( ) ), worker 0 on the calling thread, returns when all calls have
+    // returned. The job does not throw, run is not reentrant.
+    template<typename Job>
+    void run ( Job && job_ ) {
+        if ( m_threads.empty ( ) ) {
+            job_ ( std::size_t{ 0 } );
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock ( m_mutex );
+            m_job     = [ &job_ ] ( std::size_t const worker_ ) { job_ ( worker_ ); };
+            m_running = m_threads.size ( );
+            ++m_round;
+        }
+        m_wake.notify_all ( );
+        job_ ( std::size_t{ 0 } );
+        std::unique_lock<std::mutex> lock ( m_mutex );
+        m_done.wait ( lock, [ this ] { return not m_running; } );
+    }
+};
+
+inline constexpr std::size_t grain = 1'024; // The smallest range of nodes that is split up over the workers.
+
+// Calls job_ ( worker, begin, end ) with the range of every worker of [ 0, size_ ), in order, the ranges are contiguous
+// and as equal in size as they can be. A range smaller than twice the grain is done on the calling thread, as worker 0.
+template<typename Job>
+void forRanges ( Pool & pool_, std::size_t const size_, Job && job_ ) {
+    if ( size_ < 2 * grain or 1 == pool_.size ( ) ) {
+        job_ ( std::size_t{ 0 }, std::size_t{ 0 }, size_ );
+        return;
+    }
+    std::size_t const workers = pool_.size ( );
+    pool_.run ( [ & ] ( std::size_t const worker_ ) {
+        job_ ( worker_, size_ * worker_ / workers, size_ * ( worker_ + 1 ) / workers );
+    } );
+}
+
+// The state of the parallel traversals, keep one (per pool) and reuse it, it only grows.
+template<typename Tree>
+class Scratch {
+
+    using NodeID = typename Tree::NodeID;
+
+    std::unique_ptr<std::atomic<std::uint64_t>[]> m_claimed; // One bit per node.
+    std::size_t m_words = 0;
+
+    public:
+    std::vector<std::vector<NodeID>> next; // The nodes claimed by every worker, the part of the next level.
+    std::vector<std::size_t> counts;       // By worker, the prefix sums.
+
+    // Size the bitmap to size_ nodes and clear it (in parallel).
+    void reset ( Pool & pool_, std::size_t const size_ ) {
+        std::size_t const words = ( size_ + 63 ) / 64;
+        if ( words > m_words ) {
+            m_words   = std::max ( words, 2 * m_words );
+            m_claimed = std::make_unique<std::atomic<std::uint64_t>[]> ( m_words );
+        }
+        forRanges ( pool_, words, [ this ] ( std::size_t, std::size_t const begin_, std::size_t const end_ ) {
+            for ( std::size_t w = begin_; w < end_; ++w )
+                m_claimed[ w ].store ( 0u, std::memory_order_relaxed );
+        } );
+        next.resize ( pool_.size ( ) );
+        counts.resize ( pool_.size ( ) + 1 );
+    }
+
+    // Returns true if this call claimed node_, i.e. all other claims of node_ (before and after) return false.
+    [[nodiscard]] bool claim ( NodeID const node_ ) noexcept {
+        std::atomic<std::uint64_t> & word = m_claimed[ static_cast<std::size_t> ( node_.value ) / 64 ];
+        std::uint64_t const bit           = std::uint64_t{ 1 } << ( static_cast<std::size_t> ( node_.value ) % 64 );
+        if ( word.load ( std::memory_order_relaxed ) & bit ) // Seen already, no need to take the cache line.
+            return false;
+        return not( word.fetch_or ( bit, std::memory_order_relaxed ) & bit );
+    }
+};
+
+// The nodes reachable from root_, level by level, level l is order_[ levels_[ l ] .. levels_[ l + 1 ] ), visit_ (
+// worker, node ) is called (concurrently) for every node, when its out-arcs are taken. The nodes are appended to order_
+// (that is cleared first), the starts of the levels (plus the end of the last level) to levels_ (idem).
+template<typename Tree, typename Visit>
+void breadthFirst ( Tree const & tree_, typename Tree::NodeID const root_, Pool & pool_, Scratch<Tree> & scratch_,
+                    std::vector<typename Tree::NodeID> & order_, std::vector<std::size_t> & levels_, Visit && visit_ ) {
+    static_assert ( tree_access::has_arcs<Tree> and not std::is_pointer<typename Tree::NodeID>::value,
+                    "the traversals take an fst or fsth tree" );
+    using ArcID        = typename Tree::ArcID;
+    auto const & nodes = tree_access::nodes ( tree_ );
+    auto const & arcs  = tree_access::arcs ( tree_ );
+    scratch_.reset ( pool_, nodes.size ( ) );
+    [[maybe_unused]] bool const claimed = scratch_.claim ( root_ );
+    order_.assign ( 1u, root_ );
+    levels_.assign ( 1u, 0u );
+    for ( std::size_t begin = 0, end = 1; begin != end; begin = end, end = order_.size ( ) ) {
+        for ( auto & next : scratch_.next )
+            next.clear ( );
+        forRanges ( pool_, end - begin, [ & ] ( std::size_t const worker_, std::size_t const first_, std::size_t const last_ ) {
+            auto & next = scratch_.next[ worker_ ];
+            for ( std::size_t i = begin + first_; i < begin + last_; ++i ) {
+                visit_ ( worker_, order_[ i ] );
+                for ( ArcID a = nodes[ order_[ i ].value ].head_out; ArcID::invalid ( ) != a; a = arcs[ a.value ].next_out )
+                    if ( scratch_.claim ( arcs[ a.value ].target ) )
+                        next.push_back ( arcs[ a.value ].target );
+            }
+        } );
+        scratch_.counts[ 0 ] = end;
+        for ( std::size_t w = 0; w < pool_.size ( ); ++w )
+            scratch_.counts[ w + 1 ] = scratch_.counts[ w ] + scratch_.next[ w ].size ( );
+        order_.resize ( scratch_.counts[ pool_.size ( ) ] );
+        levels_.push_back ( end );
+        auto copy = [ & ] ( std::size_t const worker_ ) {
+            std::copy ( std::begin ( scratch_.next[ worker_ ] ), std::end ( scratch_.next[ worker_ ] ),
+                        std::begin ( order_ ) + scratch_.counts[ worker_ ] );
+        };
+        if ( order_.size ( ) - end < 2 * grain or 1 == pool_.size ( ) )
+            for ( std::size_t w = 0; w < pool_.size ( ); ++w )
+                copy ( w );
+        else
+            pool_.run ( copy );
+    }
+}
+
+template<typename Tree>
+void breadthFirst ( Tree const & tree_, typename Tree::NodeID const root_, Pool & pool_, Scratch<Tree> & scratch_,
+                    std::vector<typename Tree::NodeID> & order_, std::vector<std::size_t> & levels_ ) {
+    breadthFirst ( tree_, root_, pool_, scratch_, order_, levels_, [ ] ( std::size_t, typename Tree::NodeID ) noexcept {} );
+}
+
+// Destructively construct a sub-tree out of tree_, from root_ (not the root of tree_), in parallel, see above.
+template<typename Tree>
+[[nodiscard]] Tree makeSubTree ( Tree & tree_, typename Tree::NodeID const root_, Pool & pool_, Scratch<Tree> & scratch_ ) {
+    static_assert ( tree_access::has_arcs<Tree> and not std::is_pointer<typename Tree::NodeID>::value,
+                    "the traversals take an fst or fsth tree" );
+    using ArcID  = typename Tree::ArcID;
+    using NodeID = typename Tree::NodeID;
+    assert ( NodeID::invalid ( ) != root_ and tree_.root_node != root_ );
+    auto & nodes = tree_access::nodes ( tree_ );
+    auto & arcs  = tree_access::arcs ( tree_ );
+    std::vector<NodeID> order;
+    std::vector<std::size_t> levels;
+    breadthFirst ( tree_, root_, pool_, scratch_, order, levels );
+    // The new ids by old id, invalid if not in the sub-tree, and the first arc of every new node (by position in order).
+    std::vector<NodeID> fresh ( nodes.size ( ) );
+    std::vector<std::size_t> first ( order.size ( ) + 1 );
+    std::vector<std::size_t> sums ( pool_.size ( ) + 1, 0u );
+    forRanges ( pool_, order.size ( ), [ & ] ( std::size_t const worker_, std::size_t const begin_, std::size_t const end_ ) {
+        std::size_t sum = 0;
+        for ( std::size_t i = begin_; i < end_; ++i ) {
+            fresh[ order[ i ].value ] = NodeID{ i + 1 };
+            first[ i ]                = sum;
+            sum += static_cast<std::size_t> ( nodes[ order[ i ].value ].out_size );
+        }
+        sums[ worker_ + 1 ] = sum;
+    } );
+    for ( std::size_t w = 0; w < pool_.size ( ); ++w )
+        sums[ w + 1 ] += sums[ w ];
+    forRanges ( pool_, order.size ( ), [ & ] ( std::size_t const worker_, std::size_t const begin_, std::size_t const end_ ) {
+        for ( std::size_t i = begin_; i < end_; ++i )
+            first[ i ] += 2 + sums[ worker_ ]; // After the admin arc and the root arc.
+    } );
+    first.back ( ) = 2 + sums[ pool_.size ( ) ];
+    Tree sub_tree{ std::move ( nodes[ root_.value ].data ) };
+    auto & sub_nodes = tree_access::nodes ( sub_tree );
+    auto & sub_arcs  = tree_access::arcs ( sub_tree );
+    sub_nodes.resize ( order.size ( ) + 1 );
+    sub_arcs.resize ( first.back ( ) );
+    std::vector<ArcID> moved ( arcs.size ( ) ); // The new arc by old arc, of the arcs of the sub-tree.
+    // The nodes, their out-arcs (contiguous) and, for all but the root (that keeps the root arc), the data.
+    forRanges ( pool_, order.size ( ), [ & ] ( std::size_t, std::size_t const begin_, std::size_t const end_ ) {
+        for ( std::size_t i = begin_; i < end_; ++i ) {
+            auto & old_node = nodes[ order[ i ].value ];
+            auto & node     = sub_nodes[ i + 1 ];
+            if ( i ) {
+                node.data = std::move ( old_node.data );
+                if constexpr ( tree_access::has_transpositions<Tree> )
+                    node.hash = old_node.hash;
+            }
+            node.out_size = old_node.out_size;
+            if ( first[ i ] != first[ i + 1 ] ) {
+                node.head_out = ArcID{ first[ i ] };
+                node.tail_out = ArcID{ first[ i + 1 ] - 1 };
+            }
+            std::size_t id = first[ i ];
+            for ( ArcID a = old_node.head_out; ArcID::invalid ( ) != a; a = arcs[ a.value ].next_out, ++id ) {
+                auto & arc    = sub_arcs[ id ];
+                arc.source    = NodeID{ i + 1 };
+                arc.target    = fresh[ arcs[ a.value ].target.value ];
+                arc.next_out  = id + 1 != first[ i + 1 ] ? ArcID{ id + 1 } : ArcID::invalid ( );
+                moved[ a.value ] = ArcID{ id };
+                if constexpr ( not std::is_void<typename Tree::Arc::data_type>::value )
+                    tree_access::data ( arc ) = std::move ( tree_access::data ( arcs[ a.value ] ) );
+            }
+        }
+    } );
+    // The in-lists (the parent arcs), of the in-arcs from nodes in the sub-tree, in the order of the old in-lists.
+    forRanges ( pool_, order.size ( ) - 1, [ & ] ( std::size_t, std::size_t const begin_, std::size_t const end_ ) {
+        for ( std::size_t i = begin_ + 1; i < end_ + 1; ++i ) {
+            auto & node = sub_nodes[ i + 1 ];
+            if constexpr ( tree_access::has_next_in<typename Tree::Arc> ) {
+                for ( ArcID a = nodes[ order[ i ].value ].head_in; ArcID::invalid ( ) != a; a = arcs[ a.value ].next_in ) {
+                    if ( NodeID::invalid ( ) == fresh[ arcs[ a.value ].source.value ] )
+                        continue;
+                    ArcID const in = moved[ a.value ];
+                    if ( ArcID::invalid ( ) == node.head_in )
+                        node.head_in = in;
+                    else
+                        sub_arcs[ node.tail_in.value ].next_in = in;
+                    node.tail_in = in;
+                    ++node.in_size;
+                }
+            }
+            else {
+                node.parent = moved[ nodes[ order[ i ].value ].parent.value ];
+            }
+        }
+    } );
+    if constexpr ( tree_access::has_transpositions<Tree> ) {
+        auto & trans = tree_access::transpositions ( sub_tree );
+        trans.reserve ( order.size ( ) );
+        for ( std::size_t i = 1; i < sub_nodes.size ( ); ++i )
+            trans.emplace ( sub_nodes[ i ].hash, NodeID{ i } );
+    }
+    tree_access::generation ( tree_ ).bump ( ); // The data was moved out.
+    return sub_tree;
+}
+
+} // namespace ptrv
@@ -0,0 +1,364 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <chrono>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+#include "tree_access.hpp"
+#include "traversal.hpp"
+
+// Memory-budgeted pruning of an fst, fsnt or fsntu tree. The adds only append, a long search runs out of memory. prune
+// cuts the coldest sub-trees until the flat vectors fit a budget (in bytes, the size, not the capacity, of the vectors)
+// and compacts the vectors in place, the ids of the nodes (and arcs) that are kept are remapped.
+//
+//  - The cut: a node is cut (with its sub-tree) by the lowest score on its path from the root (the score of the root
+//    does not count, the root is never cut), the sub-trees below the lowest scores go first. The number of nodes to cut
+//    follows from the budget, the threshold from an nth_element over the path minima, ties at the threshold are cut in
+//    the order of the ids (in a topological order in an fst graph, where a transposition may point back to an older
+//    node), until the budget is met. A node with more parents (an fst graph) is cut when all of its parents are.
+//  - The compaction: the nodes and arcs that are kept move down (in the order of their ids, i.e. the child- and
+//    out-lists keep their order, contiguous children stay contiguous) and the lists are relinked as the adds link them.
+//    The capacity is kept, the freed room is taken by the search that continues.
+//
+// To search under a fixed ceiling, reserve the ceiling up front and, when usedBytes exceeds it, prune to a low-water
+// mark below it, such that a pause is amortized over many expansions. The pass needs an id per node (and arc) on top,
+// the remap. The score is a functor of a NodeID (the default is the visits member of the node data), a node that must
+// stay (f.e. the current path) gets the highest score. fsth is not supported, its transposition table is keyed by the
+// ids.
+//
+// A prune that compacts bumps the generation of the tree, the ids held outside of it go stale: a ckpt::CheckpointWriter
+// writes a full image with its next segment, the side structures keyed by node id move along with the remap
+// (WorkloadGenerator::remap, pw::Widener::remap, cbl::ChildBlocks::remap of fsnt and fsntu, fst child blocks are
+// rebuilt with of ( )), anything else keyed by id is cleared. The EpochMarks of a traversal start over with every walk.
+
+namespace gc {
+
+// What a prune did, the sizes of the flat vectors and their bytes (usedBytes) before and after and the pause.
+struct PruneStats {
+
+    std::size_t nodes_before = 0, nodes_after = 0;
+    std::size_t arcs_before = 0, arcs_after = 0;
+    std::size_t bytes_before = 0, bytes_after = 0;
+    std::uint64_t mark_ns = 0, compact_ns = 0; // Selecting the cut, compacting the vectors.
+
+    [[nodiscard]] std::size_t reclaimed ( ) const noexcept { return bytes_before - bytes_after; }
+    [[nodiscard]] std::uint64_t pause_ns ( ) const noexcept { return mark_ns + compact_ns; }
+
+    template<typename Stream>
+    [[maybe_unused]] friend Stream & operator<< ( Stream & out_, PruneStats const & s_ ) {
+        auto const mib = [] ( std::size_t b ) { return double ( b ) / ( 1024.0 * 1024.0 ); };
+        out_ << "pruned " << s_.nodes_before - s_.nodes_after << " nodes, " << s_.arcs_before - s_.arcs_after << " arcs, "
+             << mib ( s_.reclaimed ( ) ) << " MiB (" << mib ( s_.bytes_before ) << " -> " << mib ( s_.bytes_after )
+             << " MiB), pause " << double ( s_.pause_ns ( ) ) / 1'000'000.0 << " ms (mark " << double ( s_.mark_ns ) / 1'000'000.0
+             << ", compact " << double ( s_.compact_ns ) / 1'000'000.0 << ")\n";
+        return out_;
+    }
+};
+
+namespace detail {
+
+template<typename Data, typename = void>
+struct has_visits : std::false_type {};
+template<typename Data>
+struct has_visits<Data, std::void_t<decltype ( std::declval<Data const &> ( ).visits )>> : std::true_type {};
+
+// fsnt links the children both ways, fsntu from the tail back only.
+template<typename Node, typename = void>
+struct has_next : std::false_type {};
+template<typename Node>
+struct has_next<Node, std::void_t<decltype ( std::declval<Node const &> ( ).next )>> : std::true_type {};
+
+template<typename Tree>
+struct Visits {
+    Tree const & tree;
+    template<typename NodeID>
+    [[nodiscard]] auto operator( ) ( NodeID const node_ ) const noexcept {
+        return tree[ node_ ].visits;
+    }
+};
+
+// An fst graph, a node may have more parents, and a transposition may point back to an older node.
+template<typename Tree>
+[[nodiscard]] constexpr bool isGraph ( ) noexcept {
+    if constexpr ( tree_access::has_arcs<Tree> )
+        return tree_access::has_next_in<typename Tree::Arc>;
+    else
+        return false;
+}
+
+// Calls f_ ( parent ) for the parents of node_ (not the root), one for fsnt, fsntu and an fst tree, the sources of the
+// in-arcs for an fst graph.
+template<typename Tree, typename F>
+void forParents ( Tree & tree_, std::size_t const node_, F && f_ ) {
+    auto const & nodes = tree_access::nodes ( tree_ );
+    if constexpr ( tree_access::has_arcs<Tree> ) {
+        using ArcID      = typename Tree::ArcID;
+        auto const & arcs = tree_access::arcs ( tree_ );
+        for ( ArcID a = tree_access::head_in ( nodes[ node_ ] ); ArcID::invalid ( ) != a;
+              a       = tree_access::next_in ( arcs[ a.value ] ) )
+            f_ ( arcs[ a.value ].source );
+    }
+    else {
+        f_ ( nodes[ node_ ].up );
+    }
+}
+
+// Moves the nodes that are kept to their new ids, and relinks them, as add_node.
+template<typename Tree>
+void compactNodes ( Tree & tree_, std::vector<typename Tree::NodeID> const & fresh_, std::size_t const size_ ) {
+    using NodeID = typename Tree::NodeID;
+    using Node   = typename Tree::Node;
+    auto & nodes = tree_access::nodes ( tree_ );
+    for ( std::size_t n = 1; n < nodes.size ( ); ++n ) {
+        NodeID const id = fresh_[ n ];
+        if ( NodeID::invalid ( ) == id )
+            continue;
+        if ( static_cast<std::size_t> ( id.value ) != n )
+            nodes[ id.value ] = std::move ( nodes[ n ] );
+        Node & node = nodes[ id.value ];
+        node.up     = fresh_[ node.up.value ]; // The up-link of the root is the admin node, fresh_[ 0 ] is invalid.
+        node.prev = node.tail = NodeID::invalid ( );
+        if constexpr ( has_next<Node>::value )
+            node.next = node.head = NodeID::invalid ( );
+        node.size = 0;
+        if ( NodeID::invalid ( ) == node.up )
+            continue;
+        Node & up = nodes[ node.up.value ];
+        if constexpr ( has_next<Node>::value ) {
+            if ( NodeID::invalid ( ) == up.head )
+                up.head = id;
+            else
+                nodes[ ( node.prev = up.tail ).value ].next = id;
+        }
+        else {
+            node.prev = up.tail;
+        }
+        up.tail = id;
+        ++up.size;
+    }
+    nodes.erase ( std::begin ( nodes ) + size_, std::end ( nodes ) );
+}
+
+// Moves the nodes and the arcs that are kept (both ends kept) to their new ids, and relinks them, as addArc. Returns
+// the new number of arcs.
+template<typename Tree>
+std::size_t compactArcs ( Tree & tree_, std::vector<typename Tree::NodeID> const & fresh_, std::size_t const size_ ) {
+    using ArcID  = typename Tree::ArcID;
+    using NodeID = typename Tree::NodeID;
+    using Node   = typename Tree::Node;
+    using Arc    = typename Tree::Arc;
+    auto & nodes = tree_access::nodes ( tree_ );
+    auto & arcs  = tree_access::arcs ( tree_ );
+    for ( std::size_t n = 1; n < nodes.size ( ); ++n ) {
+        NodeID const id = fresh_[ n ];
+        if ( NodeID::invalid ( ) == id )
+            continue;
+        if ( static_cast<std::size_t> ( id.value ) != n )
+            nodes[ id.value ] = std::move ( nodes[ n ] );
+        Node & node    = nodes[ id.value ];
+        node.head_out = node.tail_out = ArcID::invalid ( );
+        node.out_size                 = 0;
+        if constexpr ( tree_access::has_next_in<Arc> ) {
+            node.head_in = node.tail_in = ArcID::invalid ( );
+            node.in_size                = 0;
+        }
+        else {
+            node.parent = ArcID::invalid ( );
+        }
+    }
+    nodes.erase ( std::begin ( nodes ) + size_, std::end ( nodes ) );
+    std::size_t kept = 1; // The admin arc.
+    for ( std::size_t a = 1; a < arcs.size ( ); ++a ) {
+        NodeID const source = fresh_[ arcs[ a ].source.value ], target = fresh_[ arcs[ a ].target.value ];
+        if ( NodeID::invalid ( ) == target or ( NodeID::invalid ( ) != arcs[ a ].source and NodeID::invalid ( ) == source ) )
+            continue;
+        ArcID const id{ kept++ };
+        if ( static_cast<std::size_t> ( id.value ) != a )
+            arcs[ id.value ] = std::move ( arcs[ a ] );
+        Arc & arc     = arcs[ id.value ];
+        arc.source    = source; // Invalid for the root arc.
+        arc.target    = target;
+        arc.next_out  = ArcID::invalid ( );
+        if ( NodeID::invalid ( ) != source ) {
+            Node & s = nodes[ source.value ];
+            if ( ArcID::invalid ( ) == s.head_out )
+                s.tail_out = s.head_out = id;
+            else
+                s.tail_out = arcs[ s.tail_out.value ].next_out = id;
+            ++s.out_size;
+        }
+        Node & t = nodes[ target.value ];
+        if constexpr ( tree_access::has_next_in<Arc> ) {
+            arc.next_in = ArcID::invalid ( );
+            if ( ArcID::invalid ( ) == t.head_in )
+                t.tail_in = t.head_in = id;
+            else
+                t.tail_in = arcs[ t.tail_in.value ].next_in = id;
+            ++t.in_size;
+        }
+        else {
+            t.parent = id;
+        }
+    }
+    arcs.erase ( std::begin ( arcs ) + kept, std::end ( arcs ) );
+    return kept;
+}
+
+} // namespace detail
+
+// The bytes of the flat vectors of tree_ in use (the size, not the capacity), the measure of the budget of prune.
+template<typename Tree>
+[[nodiscard]] std::size_t usedBytes ( Tree const & tree_ ) noexcept {
+    std::size_t bytes = tree_access::nodes ( tree_ ).size ( ) * sizeof ( typename Tree::Node );
+    if constexpr ( tree_access::has_arcs<Tree> )
+        bytes += tree_access::arcs ( tree_ ).size ( ) * sizeof ( typename Tree::Arc );
+    return bytes;
+}
+
+// Cut the sub-trees of tree_ with the lowest score_ ( NodeID ) on their paths, until usedBytes ( tree_ ) fits budget_,
+// and compact tree_ in place, see above. If remap_ is given, it gets the new id of every old id (invalid if cut).
+template<typename Tree, typename Score>
+[[maybe_unused]] PruneStats prune ( Tree & tree_, std::size_t const budget_, Score const & score_,
+                                    std::vector<typename Tree::NodeID> * remap_ = nullptr ) {
+    static_assert ( not tree_access::has_transpositions<Tree> and not std::is_pointer<typename Tree::NodeID>::value,
+                    "prune takes an fst, fsnt or fsntu tree" );
+    using NodeID = typename Tree::NodeID;
+    using Key    = std::decay_t<std::invoke_result_t<Score const &, NodeID>>;
+    using Clock  = std::chrono::steady_clock;
+    auto & nodes = tree_access::nodes ( tree_ );
+    assert ( 1 == tree_.root_node.value );
+    PruneStats stats;
+    stats.nodes_before = stats.nodes_after = nodes.size ( );
+    if constexpr ( tree_access::has_arcs<Tree> )
+        stats.arcs_before = stats.arcs_after = tree_access::arcs ( tree_ ).size ( );
+    stats.bytes_before = stats.bytes_after = usedBytes ( tree_ );
+    std::vector<NodeID> local;
+    std::vector<NodeID> & fresh = remap_ ? *remap_ : local;
+    fresh.resize ( nodes.size ( ) );
+    for ( std::size_t n = 0; n < nodes.size ( ); ++n )
+        fresh[ n ] = NodeID{ n };
+    if ( stats.bytes_before <= budget_ or nodes.size ( ) < 3 )
+        return stats;
+    auto const start = Clock::now ( );
+    // The number of nodes to cut, a node takes its in-arc with it (in a tree).
+    std::size_t per_node = sizeof ( typename Tree::Node );
+    if constexpr ( tree_access::has_arcs<Tree> )
+        per_node += sizeof ( typename Tree::Arc );
+    std::size_t const cut = std::min ( ( stats.bytes_before - budget_ + per_node - 1 ) / per_node, nodes.size ( ) - 2 );
+    // The nodes below the root, parents before their children. In a tree the ids are in that order, an fst graph is
+    // sorted topologically (the nodes that are not reached from the root are left out, they are cut).
+    std::vector<NodeID> order;
+    if constexpr ( detail::isGraph<Tree> ( ) ) {
+        trv::Scratch<Tree> scratch;
+        trv::topologicalSort ( tree_, tree_.root_node, order, nullptr, scratch );
+    }
+    auto const forBelowRoot = [ & ] ( auto && f_ ) {
+        if constexpr ( detail::isGraph<Tree> ( ) )
+            for ( std::size_t i = 1; i < order.size ( ); ++i )
+                f_ ( static_cast<std::size_t> ( order[ i ].value ) );
+        else
+            for ( std::size_t n = 2; n < nodes.size ( ); ++n )
+                f_ ( n );
+    };
+    // The lowest score on the path of every node, of a node with more parents (an fst graph) the path of the parent with
+    // the highest.
+    std::vector<Key> minimum ( nodes.size ( ) );
+    forBelowRoot ( [ & ] ( std::size_t const n ) {
+        Key up{};
+        bool bounded = true, found = false;
+        detail::forParents ( tree_, n, [ & ] ( NodeID const parent_ ) {
+            if ( 1 == parent_.value ) // The score of the root does not count.
+                bounded = false;
+            else if ( not found or up < minimum[ parent_.value ] )
+                up = minimum[ parent_.value ], found = true;
+        } );
+        minimum[ n ] = score_ ( NodeID{ n } );
+        if ( bounded and found and up < minimum[ n ] )
+            minimum[ n ] = up;
+    } );
+    std::vector<Key> sorted ( std::begin ( minimum ) + 2, std::end ( minimum ) );
+    std::nth_element ( std::begin ( sorted ), std::begin ( sorted ) + ( cut - 1 ), std::end ( sorted ) );
+    Key const threshold = sorted[ cut - 1 ];
+    // The nodes below the threshold are all cut, the remainder of the cut is taken from the ties.
+    auto const below = std::count_if ( std::begin ( sorted ), std::begin ( sorted ) + ( cut - 1 ),
+                                       [ & ] ( Key const & key_ ) { return key_ < threshold; } );
+    std::size_t ties = cut - static_cast<std::size_t> ( below );
+    sorted = std::vector<Key> ( );
+    // Cut (a node whose parents are all cut is cut), parents first, the nodes that are kept keep their id for now.
+    std::fill ( std::begin ( fresh ) + 2, std::end ( fresh ), NodeID::invalid ( ) );
+    forBelowRoot ( [ & ] ( std::size_t const n ) {
+        bool orphan = true;
+        detail::forParents ( tree_, n, [ & ] ( NodeID const parent_ ) {
+            orphan = orphan and NodeID::invalid ( ) == fresh[ parent_.value ];
+        } );
+        bool const tie = not( minimum[ n ] < threshold ) and not( threshold < minimum[ n ] );
+        if ( orphan or minimum[ n ] < threshold or ( tie and ties ) ) {
+            if ( tie and ties )
+                --ties;
+        }
+        else {
+            fresh[ n ] = NodeID{ n };
+        }
+    } );
+    // Number the nodes that are kept, in the order of their ids, the compaction moves them down.
+    std::size_t kept = 2;
+    for ( std::size_t n = 2; n < nodes.size ( ); ++n )
+        if ( NodeID::invalid ( ) != fresh[ n ] )
+            fresh[ n ] = NodeID{ kept++ };
+    minimum         = std::vector<Key> ( );
+    auto const mark = Clock::now ( );
+    if constexpr ( tree_access::has_arcs<Tree> )
+        stats.arcs_after = detail::compactArcs ( tree_, fresh, kept );
+    else
+        detail::compactNodes ( tree_, fresh, kept );
+    tree_access::generation ( tree_ ).bump ( ); // The ids moved.
+    stats.nodes_after = kept;
+    stats.bytes_after = usedBytes ( tree_ );
+    auto const ns     = [] ( Clock::duration const d_ ) {
+        return static_cast<std::uint64_t> ( std::chrono::duration_cast<std::chrono::nanoseconds> ( d_ ).count ( ) );
+    };
+    stats.mark_ns    = ns ( mark - start );
+    stats.compact_ns = ns ( Clock::now ( ) - mark );
+    return stats;
+}
+
+// As above, the score is the visits member of the node data.
+template<typename Tree>
+[[maybe_unused]] PruneStats prune ( Tree & tree_, std::size_t const budget_,
+                                    std::vector<typename Tree::NodeID> * remap_ = nullptr ) {
+    static_assert ( detail::has_visits<typename Tree::Node::data_type>::value,
+                    "the default score of prune is the visits member of the node data, give a score" );
+    return prune ( tree_, budget_, detail::Visits<Tree>{ tree_ }, remap_ );
+}
+
+} // namespace gc
@@ -0,0 +1,257 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+#include "tree_access.hpp"
+
+// Relayout of a (finished) fst or fsth tree. The trees are numbered in the order of
+// expansion, so a root-to-leaf descent touches a node and an arc (list) in a random
+// cache line per level. The relayout renumbers the nodes in a locality preserving
+// order and rebuilds the arcs, such that the out-arcs of a node are contiguous and
+// in the order of the new node numbering. The result is an ordinary tree of the
+// same type, but it is meant to be frozen: it can still grow, but the new nodes go
+// to the back and the layout degrades.
+//
+// Two orders are available:
+//
+//  - van_emde_boas, the cache-oblivious layout, the tree is cut at half its height,
+//    the top half is laid out (recursively) first, followed by the bottom sub-trees
+//    (recursively), left to right. A descent of height h touches O ( h / log B )
+//    blocks, whatever the block size B (cache line, page).
+//  - hot_path_first, a pre-order, so that the first child of a node follows it
+//    directly, i.e. a descent along the first children is a sequential scan.
+//
+// In both orders the children of a node are ordered by a key, descending, so that
+// the hot children come first; the default key is the visits member of the node
+// data when it has one, otherwise the order of the out-list (the order of expansion)
+// is kept. A transposition (fsth) is laid out with the parent that gets to it first.
+// Nodes that are not reachable from the root are dropped, as in makeSubTree.
+
+namespace lyt {
+
+enum class Order : int { van_emde_boas, hot_path_first };
+
+namespace detail {
+
+template<typename Data, typename = void>
+struct has_visits : std::false_type {};
+template<typename Data>
+struct has_visits<Data, std::void_t<decltype ( std::declval<Data const &> ( ).visits )>> : std::true_type {};
+
+template<typename Tree>
+struct DefaultKey {
+    Tree const & tree;
+    template<typename NodeID>
+    [[nodiscard]] auto operator( ) ( NodeID const node_ ) const noexcept {
+        if constexpr ( has_visits<typename Tree::Node::data_type>::value )
+            return tree[ node_ ].visits;
+        else
+            return 0;
+    }
+};
+
+template<typename Tree>
+class Planner {
+
+    using ArcID  = typename Tree::ArcID;
+    using NodeID = typename Tree::NodeID;
+
+    Tree const & m_tree;
+    std::vector<ArcID> m_out;           // The out-arcs of all nodes, sorted by key, m_out[ m_first[ n ] .. m_first[ n + 1 ] ).
+    std::vector<std::size_t> m_first;   // By (old) node.
+    std::vector<NodeID> m_order;        // The (old) nodes in the new order.
+    std::vector<NodeID> m_new;          // The new node by old node, invalid if not placed yet.
+    std::vector<NodeID> m_frontier;     // The roots of the bottom sub-trees, shared by the recursion.
+    std::vector<std::pair<NodeID, Int>> m_stack;
+    std::vector<std::uint32_t> m_seen; // The walk that last saw a node, no node is walked twice in a walk (fsth).
+    std::uint32_t m_walk = 0;
+
+    [[nodiscard]] NodeID target ( ArcID const arc_ ) const noexcept {
+        return tree_access::arcs ( m_tree )[ arc_.value ].target;
+    }
+
+    void place ( NodeID const node_ ) {
+        if ( NodeID::invalid ( ) == m_new[ node_.value ] ) {
+            m_order.push_back ( node_ );
+            m_new[ node_.value ] = NodeID{ m_order.size ( ) };
+        }
+    }
+
+    void next_walk ( ) noexcept {
+        if ( not ++m_walk ) { // Wrapped, start over.
+            std::fill ( std::begin ( m_seen ), std::end ( m_seen ), 0u );
+            m_walk = 1;
+        }
+    }
+
+    // Appends the unplaced nodes at depth_ below root_ to the frontier, in the order of the children.
+    void frontier ( NodeID const root_, Int const depth_ ) {
+        next_walk ( );
+        m_stack.emplace_back ( root_, 0 );
+        m_seen[ root_.value ] = m_walk;
+        while ( m_stack.size ( ) ) {
+            auto const [ node, depth ] = m_stack.back ( );
+            m_stack.pop_back ( );
+            if ( depth_ == depth ) {
+                if ( NodeID::invalid ( ) == m_new[ node.value ] )
+                    m_frontier.push_back ( node );
+                continue;
+            }
+            for ( std::size_t i = m_first[ node.value + 1 ]; i-- > m_first[ node.value ]; ) { // Reversed, popped in order.
+                NodeID const child = target ( m_out[ i ] );
+                if ( m_walk != m_seen[ child.value ] ) {
+                    m_seen[ child.value ] = m_walk;
+                    m_stack.emplace_back ( child, depth + 1 );
+                }
+            }
+        }
+    }
+
+    public:
+    template<typename Key>
+    Planner ( Tree const & tree_, Key const & key_ ) : m_tree{ tree_ } {
+        auto const & nodes = tree_access::nodes ( tree_ );
+        auto const & arcs  = tree_access::arcs ( tree_ );
+        m_first.reserve ( nodes.size ( ) + 1 );
+        m_out.reserve ( arcs.size ( ) );
+        m_first.push_back ( 0 );
+        for ( std::size_t n = 0; n < nodes.size ( ); ++n ) {
+            std::size_t const first = m_out.size ( );
+            if ( n )
+                for ( auto it = tree_.cbeginOut ( NodeID{ n } ); it.is_valid ( ); ++it )
+                    m_out.push_back ( it.id ( ) );
+            std::stable_sort ( std::begin ( m_out ) + first, std::end ( m_out ), [ this, &key_ ] ( ArcID const a, ArcID const b ) {
+                return key_ ( target ( b ) ) < key_ ( target ( a ) );
+            } );
+            m_first.push_back ( m_out.size ( ) );
+        }
+        m_new.resize ( nodes.size ( ), NodeID::invalid ( ) );
+        m_seen.resize ( nodes.size ( ), 0u );
+        m_order.reserve ( nodes.size ( ) - 1 );
+    }
+
+    // The height of the tree (the root only is 1), along the first in-arcs, which precede their targets.
+    [[nodiscard]] Int height ( ) const {
+        auto const & nodes = tree_access::nodes ( m_tree );
+        auto const & arcs  = tree_access::arcs ( m_tree );
+        std::vector<Int> depth ( nodes.size ( ), 0 );
+        Int height = 1;
+        depth[ m_tree.root_node.value ] = 1;
+        for ( std::size_t n = m_tree.root_node.value + 1u; n < nodes.size ( ); ++n ) {
+            ArcID const in = tree_access::head_in ( nodes[ n ] );
+            if ( ArcID::invalid ( ) != in )
+                height = std::max ( height, depth[ n ] = depth[ arcs[ in.value ].source.value ] + 1 );
+        }
+        return height;
+    }
+
+    void vanEmdeBoas ( NodeID const root_, Int const height_ ) {
+        if ( 1 == height_ ) {
+            place ( root_ );
+            return;
+        }
+        Int const top = height_ / 2;
+        vanEmdeBoas ( root_, top );
+        std::size_t const first = m_frontier.size ( );
+        frontier ( root_, top );
+        std::size_t const last = m_frontier.size ( );
+        for ( std::size_t i = first; i < last; ++i ) // By index, the recursion appends to (and pops from) the frontier.
+            vanEmdeBoas ( m_frontier[ i ], height_ - top );
+        m_frontier.resize ( first );
+    }
+
+    // Pre-order, also places what the van Emde Boas layout did not get to (fsth, a transposition deeper than the
+    // height along the first in-arcs).
+    void hotPathFirst ( NodeID const root_ ) {
+        next_walk ( );
+        m_stack.emplace_back ( root_, 0 );
+        while ( m_stack.size ( ) ) {
+            NodeID const node = m_stack.back ( ).first;
+            m_stack.pop_back ( );
+            if ( m_walk == m_seen[ node.value ] )
+                continue;
+            m_seen[ node.value ] = m_walk;
+            place ( node );
+            for ( std::size_t i = m_first[ node.value + 1 ]; i-- > m_first[ node.value ]; ) // Reversed, popped in order.
+                if ( m_walk != m_seen[ target ( m_out[ i ] ).value ] )
+                    m_stack.emplace_back ( target ( m_out[ i ] ), 0 );
+        }
+    }
+
+    [[nodiscard]] Tree build ( ) const {
+        auto const & nodes = tree_access::nodes ( m_tree );
+        auto const & arcs  = tree_access::arcs ( m_tree );
+        assert ( m_order.size ( ) and m_tree.root_node == m_order.front ( ) );
+        Tree tree ( nodes[ m_order.front ( ).value ].data );
+        for ( std::size_t i = 1; i < m_order.size ( ); ++i ) {
+            auto const & node = nodes[ m_order[ i ].value ];
+            if constexpr ( tree_access::has_transpositions<Tree> )
+                tree.addNode ( std::remove_const_t<decltype ( Tree::root_hash )>{ node.hash }, node.data );
+            else
+                tree.addNode ( node.data );
+        }
+        for ( std::size_t i = 0; i < m_order.size ( ); ++i ) {
+            NodeID const source{ i + 1 };
+            for ( std::size_t o = m_first[ m_order[ i ].value ]; o < m_first[ m_order[ i ].value + 1 ]; ++o ) {
+                auto const & arc = arcs[ m_out[ o ].value ];
+                if constexpr ( std::is_void<typename Tree::Arc::data_type>::value )
+                    tree.addArc ( source, m_new[ arc.target.value ] );
+                else
+                    tree.addArc ( source, m_new[ arc.target.value ], tree_access::data ( arc ) );
+            }
+        }
+        return tree;
+    }
+};
+
+} // namespace detail
+
+// Returns a copy of tree_, renumbered in order_, the children ordered by key_ ( NodeID ) (of tree_), descending.
+template<typename Tree, typename Key>
+[[nodiscard]] Tree relayout ( Tree const & tree_, Order const order_, Key const & key_ ) {
+    static_assert ( tree_access::has_arcs<Tree> and not std::is_pointer<typename Tree::NodeID>::value,
+                    "relayout takes an fst or fsth tree" );
+    detail::Planner<Tree> planner ( tree_, key_ );
+    if ( Order::van_emde_boas == order_ )
+        planner.vanEmdeBoas ( tree_.root_node, planner.height ( ) );
+    planner.hotPathFirst ( tree_.root_node );
+    return planner.build ( );
+}
+
+template<typename Tree>
+[[nodiscard]] Tree relayout ( Tree const & tree_, Order const order_ = Order::van_emde_boas ) {
+    return relayout ( tree_, order_, detail::DefaultKey<Tree>{ tree_ } );
+}
+
+} // namespace lyt
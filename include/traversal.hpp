@@ -0,0 +1,202 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+#include "tree_access.hpp"
+
+// Traversals of an fst or fsth tree (from a node, along the out-arcs), that report to a visitor. A visitor derives from
+// trv::Visitor and hides the events it is interested in (the traversals call the events on the type of the visitor):
+//
+//  - pre ( node ), node is entered, depth first when it is discovered, breadth first when it leaves the queue, skip
+//    leaves its out-arcs alone (there is no post for it then).
+//  - arc ( source, arc, target, first ), an out-arc of an entered node, first when target was not discovered before
+//    (a tree arc, otherwise a transposition, fsth), skip does not follow the arc.
+//  - post ( node ), depth first only, all nodes reachable from node (that were not discovered before) are done.
+//
+// Every event can return stop, the traversal returns at once (returning false). The traversals keep their state in a
+// trv::Scratch that the caller owns, keep one (per thread) and reuse it, the traversals then do not allocate (once the
+// scratch has grown) and the visited marks (EpochMarks) are reset in O ( 1 ), i.e. the cost of a traversal is that of
+// the part of the tree it walks.
+
+namespace trv {
+
+enum class Visit : int { proceed, skip, stop };
+
+struct Visitor {
+    template<typename NodeID>
+    [[nodiscard]] constexpr Visit pre ( NodeID const ) noexcept {
+        return Visit::proceed;
+    }
+    template<typename NodeID, typename ArcID>
+    [[nodiscard]] constexpr Visit arc ( NodeID const, ArcID const, NodeID const, bool const ) noexcept {
+        return Visit::proceed;
+    }
+    template<typename NodeID>
+    [[nodiscard]] constexpr Visit post ( NodeID const ) noexcept {
+        return Visit::proceed;
+    }
+};
+
+template<typename Tree>
+struct Scratch {
+    using ArcID  = typename Tree::ArcID;
+    using NodeID = typename Tree::NodeID;
+
+    EpochMarks marks;                            // The discovered nodes.
+    std::vector<NodeID> queue;                   // Breadth first.
+    std::vector<std::pair<NodeID, ArcID>> stack; // Depth first, the nodes entered and their next out-arc.
+    std::vector<typename NodeID::value_type> in; // Topological sort, the in-arcs left, by discovered node.
+};
+
+template<typename Tree, typename Visitor>
+[[maybe_unused]] bool breadthFirst ( Tree const & tree_, typename Tree::NodeID const root_, Visitor && visitor_,
+                                     Scratch<Tree> & scratch_ ) {
+    static_assert ( tree_access::has_arcs<Tree> and not std::is_pointer<typename Tree::NodeID>::value,
+                    "the traversals take an fst or fsth tree" );
+    using ArcID        = typename Tree::ArcID;
+    using NodeID       = typename Tree::NodeID;
+    auto const & nodes = tree_access::nodes ( tree_ );
+    auto const & arcs  = tree_access::arcs ( tree_ );
+    scratch_.marks.next ( nodes.size ( ) );
+    scratch_.queue.clear ( );
+    scratch_.marks.mark ( root_.value );
+    scratch_.queue.push_back ( root_ );
+    for ( std::size_t i = 0; i < scratch_.queue.size ( ); ++i ) { // By index, the queue grows.
+        NodeID const node = scratch_.queue[ i ];
+        Visit const visit = visitor_.pre ( node );
+        if ( Visit::stop == visit )
+            return false;
+        if ( Visit::skip == visit )
+            continue;
+        for ( ArcID a = nodes[ node.value ].head_out; ArcID::invalid ( ) != a; a = arcs[ a.value ].next_out ) {
+            NodeID const target = arcs[ a.value ].target;
+            bool const first    = not scratch_.marks.is_marked ( target.value );
+            Visit const follow  = visitor_.arc ( node, a, target, first );
+            if ( Visit::stop == follow )
+                return false;
+            if ( first and Visit::proceed == follow ) {
+                scratch_.marks.mark ( target.value );
+                scratch_.queue.push_back ( target );
+            }
+        }
+    }
+    return true;
+}
+
+template<typename Tree, typename Visitor>
+[[maybe_unused]] bool depthFirst ( Tree const & tree_, typename Tree::NodeID const root_, Visitor && visitor_,
+                                   Scratch<Tree> & scratch_ ) {
+    static_assert ( tree_access::has_arcs<Tree> and not std::is_pointer<typename Tree::NodeID>::value,
+                    "the traversals take an fst or fsth tree" );
+    using ArcID        = typename Tree::ArcID;
+    using NodeID       = typename Tree::NodeID;
+    auto const & nodes = tree_access::nodes ( tree_ );
+    auto const & arcs  = tree_access::arcs ( tree_ );
+    scratch_.marks.next ( nodes.size ( ) );
+    scratch_.stack.clear ( );
+    scratch_.marks.mark ( root_.value );
+    Visit const visit = visitor_.pre ( root_ );
+    if ( Visit::stop == visit )
+        return false;
+    if ( Visit::proceed == visit )
+        scratch_.stack.emplace_back ( root_, nodes[ root_.value ].head_out );
+    while ( scratch_.stack.size ( ) ) {
+        auto const [ node, a ] = scratch_.stack.back ( );
+        if ( ArcID::invalid ( ) == a ) {
+            scratch_.stack.pop_back ( );
+            if ( Visit::stop == visitor_.post ( node ) )
+                return false;
+            continue;
+        }
+        scratch_.stack.back ( ).second = arcs[ a.value ].next_out;
+        NodeID const target            = arcs[ a.value ].target;
+        bool const first               = not scratch_.marks.is_marked ( target.value );
+        Visit const follow             = visitor_.arc ( node, a, target, first );
+        if ( Visit::stop == follow )
+            return false;
+        if ( first and Visit::proceed == follow ) {
+            scratch_.marks.mark ( target.value );
+            Visit const enter = visitor_.pre ( target );
+            if ( Visit::stop == enter )
+                return false;
+            if ( Visit::proceed == enter )
+                scratch_.stack.emplace_back ( target, nodes[ target.value ].head_out );
+        }
+    }
+    return true;
+}
+
+// Appends the nodes reachable from root_ to sorted_, in topological order (Kahn), in O ( nodes + arcs ): the in-arcs
+// left of every node are counted down as the arcs are taken, a node follows when its last in-arc is taken. From the root
+// of the tree, the counts start at in_size, in one pass over the nodes, from another node, a breadth first walk counts
+// the in-arcs from the reachable nodes (a transposition can have parents outside of the part that is walked). The
+// nodes come in layers, a node is in the layer after the last of its parents to come (the longest path to it from
+// root_), the nodes of a layer do not depend on each other (f.e. the layers can be backed up bottom-up, a layer in
+// parallel). If layers_, the start of every layer in sorted_ is appended to it, plus the end of the last layer.
+template<typename Tree>
+void topologicalSort ( Tree const & tree_, typename Tree::NodeID const root_, std::vector<typename Tree::NodeID> & sorted_,
+                       std::vector<std::size_t> * const layers_, Scratch<Tree> & scratch_ ) {
+    using ArcID        = typename Tree::ArcID;
+    using NodeID       = typename Tree::NodeID;
+    using Count        = typename NodeID::value_type;
+    auto const & nodes = tree_access::nodes ( tree_ );
+    auto const & arcs  = tree_access::arcs ( tree_ );
+    struct InArcs : Visitor {
+        std::vector<Count> & in;
+        Visit arc ( NodeID const, ArcID const, NodeID const target_, bool const first_ ) noexcept {
+            in[ target_.value ] = first_ ? Count{ 1 } : in[ target_.value ] + 1;
+            return Visit::proceed;
+        }
+    };
+    if ( scratch_.in.size ( ) < nodes.size ( ) )
+        scratch_.in.resize ( std::max ( nodes.size ( ), 2 * scratch_.in.size ( ) ) );
+    if ( tree_.root_node == root_ )
+        for ( std::size_t n = 0; n < nodes.size ( ); ++n )
+            scratch_.in[ n ] = static_cast<Count> ( tree_access::in_size ( nodes[ n ] ) );
+    else
+        breadthFirst ( tree_, root_, InArcs{ { }, scratch_.in }, scratch_ );
+    std::size_t i = sorted_.size ( );
+    sorted_.push_back ( root_ );
+    while ( i < sorted_.size ( ) ) {
+        if ( layers_ )
+            layers_->push_back ( i );
+        for ( std::size_t const end = sorted_.size ( ); i < end; ++i ) // The layer, the next one is appended.
+            for ( ArcID a = nodes[ sorted_[ i ].value ].head_out; ArcID::invalid ( ) != a; a = arcs[ a.value ].next_out )
+                if ( not --scratch_.in[ arcs[ a.value ].target.value ] )
+                    sorted_.push_back ( arcs[ a.value ].target );
+    }
+    if ( layers_ )
+        layers_->push_back ( sorted_.size ( ) );
+}
+
+} // namespace trv
@@ -0,0 +1,119 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <type_traits>
+#include <utility>
+
+#include "types.hpp"
+
+// Like cereal::access, befriended by the trees and their arcs, this class gives the
+// tree-generic tools (snapshots, checkpoints, relayout, etc.) access to the flat vectors.
+class tree_access {
+
+    template<typename Tree, typename = void>
+    struct has_arcs_impl : std::false_type {};
+    template<typename Tree>
+    struct has_arcs_impl<Tree, std::void_t<typename Tree::ArcID>> : std::true_type {};
+
+    template<typename Tree, typename = void>
+    struct has_transpositions_impl : std::false_type {};
+    template<typename Tree>
+    struct has_transpositions_impl<Tree, std::void_t<typename Tree::Trans>> : std::true_type {};
+
+    template<typename Node, typename = void>
+    struct has_parent_impl : std::false_type {};
+    template<typename Node>
+    struct has_parent_impl<Node, std::void_t<decltype ( std::declval<Node const &> ( ).parent )>> : std::true_type {};
+
+    template<typename Arc, typename = void>
+    struct has_next_in_impl : std::false_type {};
+    template<typename Arc>
+    struct has_next_in_impl<Arc, std::void_t<decltype ( std::declval<Arc const &> ( ).next_in )>> : std::true_type {};
+
+    public:
+    // fst and fsth have arcs, fsnt and fsntu are node-only.
+    template<typename Tree>
+    static constexpr bool has_arcs = has_arcs_impl<std::remove_const_t<Tree>>::value;
+    // fsth keeps a transposition table.
+    template<typename Tree>
+    static constexpr bool has_transpositions = has_transpositions_impl<std::remove_const_t<Tree>>::value;
+
+    template<typename Tree>
+    [[nodiscard]] static auto & arcs ( Tree & tree_ ) noexcept {
+        return tree_.m_arcs;
+    }
+    template<typename Tree>
+    [[nodiscard]] static auto & nodes ( Tree & tree_ ) noexcept {
+        return tree_.m_nodes;
+    }
+    template<typename Tree>
+    [[nodiscard]] static auto & transpositions ( Tree & tree_ ) noexcept {
+        return tree_.m_trans;
+    }
+
+    // The generation of the tree, bumped by the tools that rebuild it in place (f.e. gc::prune).
+    template<typename Tree>
+    [[nodiscard]] static auto & generation ( Tree & tree_ ) noexcept {
+        return tree_.m_generation;
+    }
+
+    template<typename Arc>
+    [[nodiscard]] static auto & data ( Arc & arc_ ) noexcept {
+        return arc_.data;
+    }
+
+    // The arcs of fst with Links::tree have no next_in, its nodes keep a parent arc instead of an in-list.
+    template<typename Arc>
+    static constexpr bool has_next_in = has_next_in_impl<std::remove_const_t<Arc>>::value;
+
+    // The first in-arc of node_ (fst, fsth), the parent arc in a tree.
+    template<typename Node>
+    [[nodiscard]] static auto head_in ( Node const & node_ ) noexcept {
+        if constexpr ( has_parent_impl<Node>::value )
+            return node_.parent;
+        else
+            return node_.head_in;
+    }
+    // The in-arc following arc_ in the in-list of its target, none in a tree.
+    template<typename Arc>
+    [[nodiscard]] static auto next_in ( Arc const & arc_ ) noexcept {
+        if constexpr ( has_next_in<Arc> )
+            return arc_.next_in;
+        else
+            return Arc::type::invalid ( );
+    }
+    // The number of in-arcs of node_.
+    template<typename Node>
+    [[nodiscard]] static auto in_size ( Node const & node_ ) noexcept {
+        if constexpr ( has_parent_impl<Node>::value )
+            return static_cast<decltype ( node_.out_size )> ( decltype ( node_.parent )::invalid ( ) != node_.parent );
+        else
+            return node_.in_size;
+    }
+};
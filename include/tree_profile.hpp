@@ -0,0 +1,171 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <iomanip>
+#include <type_traits>
+#include <vector>
+
+#include "types.hpp"
+#include "tree_access.hpp"
+#include "traversal.hpp"
+
+// Shape and memory of a tree, as returned by the profile ( ) members of the trees.
+struct TreeProfile {
+
+    std::size_t nodes = 0, arcs = 0, leaves = 0;
+    std::size_t transpositions = 0; // Nodes with more than one parent (fsth).
+    std::vector<std::size_t> depth;     // Number of nodes by depth (the root is at depth 0).
+    std::vector<std::size_t> branching; // Number of nodes by number of children.
+
+    std::size_t node_size = 0, arc_size = 0; // sizeof, the payload included.
+    std::size_t node_payload_size = 0;       // sizeof the node data.
+    std::size_t node_payload_used = 0;       // Bytes of node data in use, if the data has a size ( ) and a capacity ( ).
+    std::size_t node_bytes = 0, node_capacity_bytes = 0;
+    std::size_t arc_bytes = 0, arc_capacity_bytes = 0;
+    std::size_t trans_bytes = 0; // The transposition table, estimated as a slot and a control byte per bucket.
+
+    [[nodiscard]] std::size_t bytes ( ) const noexcept { return node_capacity_bytes + arc_capacity_bytes + trans_bytes; }
+    [[nodiscard]] std::size_t slack ( ) const noexcept {
+        return node_capacity_bytes - node_bytes + arc_capacity_bytes - arc_bytes;
+    }
+    [[nodiscard]] double meanDepth ( ) const noexcept {
+        std::size_t sum = 0;
+        for ( std::size_t d = 0; d < depth.size ( ); ++d )
+            sum += d * depth[ d ];
+        return nodes ? double ( sum ) / nodes : 0.0;
+    }
+    // Mean number of children of the internal nodes.
+    [[nodiscard]] double meanBranching ( ) const noexcept {
+        std::size_t sum = 0;
+        for ( std::size_t b = 1; b < branching.size ( ); ++b )
+            sum += b * branching[ b ];
+        return nodes > leaves ? double ( sum ) / ( nodes - leaves ) : 0.0;
+    }
+
+    template<typename Stream>
+    [[maybe_unused]] friend Stream & operator<< ( Stream & out_, TreeProfile const & p_ ) {
+        auto const mib = [] ( std::size_t b ) { return double ( b ) / ( 1024.0 * 1024.0 ); };
+        out_ << "nodes " << p_.nodes << ", arcs " << p_.arcs << ", leaves " << p_.leaves << " ("
+             << ( p_.nodes ? 100.0 * p_.leaves / p_.nodes : 0.0 ) << "%), transpositions " << p_.transpositions << '\n';
+        out_ << "depth max " << ( p_.depth.size ( ) ? p_.depth.size ( ) - 1 : 0 ) << ", mean " << p_.meanDepth ( ) << ':';
+        for ( std::size_t const n : p_.depth )
+            out_ << ' ' << n;
+        out_ << '\n' << "branching max " << ( p_.branching.size ( ) ? p_.branching.size ( ) - 1 : 0 ) << ", mean "
+             << p_.meanBranching ( ) << ':';
+        for ( std::size_t const n : p_.branching )
+            out_ << ' ' << n;
+        out_ << '\n' << "node " << p_.node_size << " B (payload " << p_.node_payload_size << " B, "
+             << ( p_.nodes ? double ( p_.node_payload_used ) / p_.nodes : 0.0 ) << " B used), arc " << p_.arc_size << " B\n";
+        out_ << "memory " << mib ( p_.bytes ( ) ) << " MiB: nodes " << mib ( p_.node_bytes ) << " / "
+             << mib ( p_.node_capacity_bytes ) << ", arcs " << mib ( p_.arc_bytes ) << " / " << mib ( p_.arc_capacity_bytes )
+             << ", trans " << mib ( p_.trans_bytes ) << ", slack " << mib ( p_.slack ( ) ) << ", "
+             << ( p_.nodes ? double ( p_.bytes ( ) ) / p_.nodes : 0.0 ) << " B/node\n";
+        return out_;
+    }
+
+    private:
+    template<typename Data, typename = void>
+    struct has_size_capacity : std::false_type {};
+    template<typename Data>
+    struct has_size_capacity<Data, std::void_t<decltype ( std::declval<Data const &> ( ).size ( ) ),
+                                               decltype ( std::declval<Data const &> ( ).capacity ( ) )>> : std::true_type {};
+
+    public:
+    // One pass over the nodes, in index order. The depth of a node is that of its (first) parent plus one. In fsnt and
+    // fsntu a parent precedes its children in the flat vectors (the trees only append, and sub-trees are copied breadth
+    // or depth first), so the depth of the parent is known when the child is visited. In fst and fsth an arc may come
+    // from a newer node (a transposition, or a node added before it is linked), the depths are computed up front, in a
+    // topological order (trv::topologicalSort), a node that is not reached from the root is at depth 0.
+    template<typename Tree>
+    [[nodiscard]] static TreeProfile of ( Tree const & tree_ ) {
+        auto const & nodes = tree_access::nodes ( tree_ );
+        using Node         = typename std::decay_t<decltype ( nodes )>::value_type;
+        using NodeData     = decltype ( Node::data );
+        TreeProfile p;
+        p.node_size           = sizeof ( Node );
+        p.node_payload_size   = sizeof ( NodeData );
+        p.node_bytes          = nodes.size ( ) * sizeof ( Node );
+        p.node_capacity_bytes = nodes.capacity ( ) * sizeof ( Node );
+        std::vector<Int> depth ( nodes.size ( ), 0 );
+        if constexpr ( tree_access::has_arcs<Tree> ) {
+            auto const & arcs = tree_access::arcs ( tree_ );
+            std::vector<typename Tree::NodeID> order;
+            trv::Scratch<Tree> scratch;
+            trv::topologicalSort ( tree_, tree_.root_node, order, nullptr, scratch );
+            for ( std::size_t o = 1; o < order.size ( ); ++o ) { // The root first.
+                auto const n = order[ o ].value;
+                depth[ n ]   = depth[ arcs[ tree_access::head_in ( nodes[ n ] ).value ].source.value ] + 1;
+            }
+        }
+        for ( std::size_t i = tree_.root_node.value; i < nodes.size ( ); ++i ) {
+            Node const & node = nodes[ i ];
+            std::size_t children;
+            if constexpr ( tree_access::has_arcs<Tree> ) {
+                children = static_cast<std::size_t> ( node.out_size );
+                if ( i != static_cast<std::size_t> ( tree_.root_node.value ) )
+                    p.transpositions += tree_access::in_size ( node ) > 1;
+            }
+            else {
+                children = static_cast<std::size_t> ( node.size );
+                if ( i != static_cast<std::size_t> ( tree_.root_node.value ) )
+                    depth[ i ] = depth[ node.up.value ] + 1;
+            }
+            if ( static_cast<std::size_t> ( depth[ i ] ) >= p.depth.size ( ) )
+                p.depth.resize ( depth[ i ] + 1, 0 );
+            ++p.depth[ depth[ i ] ];
+            if ( children >= p.branching.size ( ) )
+                p.branching.resize ( children + 1, 0 );
+            ++p.branching[ children ];
+            p.leaves += not children;
+            if constexpr ( has_size_capacity<NodeData>::value ) // Pro rata.
+                p.node_payload_used += sizeof ( NodeData ) * static_cast<std::size_t> ( node.data.size ( ) ) /
+                                       static_cast<std::size_t> ( node.data.capacity ( ) );
+            else
+                p.node_payload_used += sizeof ( NodeData );
+            ++p.nodes;
+        }
+        if constexpr ( tree_access::has_arcs<Tree> ) {
+            auto const & arcs = tree_access::arcs ( tree_ );
+            using Arc         = typename std::decay_t<decltype ( arcs )>::value_type;
+            p.arcs               = arcs.size ( ) - 2; // The admin arc and the root arc.
+            p.arc_size           = sizeof ( Arc );
+            p.arc_bytes          = arcs.size ( ) * sizeof ( Arc );
+            p.arc_capacity_bytes = arcs.capacity ( ) * sizeof ( Arc );
+        }
+        else {
+            p.arcs = p.nodes ? p.nodes - 1 : 0; // Implicit, the up-links.
+        }
+        if constexpr ( tree_access::has_transpositions<Tree> ) {
+            auto const & trans = tree_access::transpositions ( tree_ );
+            p.trans_bytes      = trans.bucket_count ( ) * ( sizeof ( typename Tree::Trans::value_type ) + 1 );
+        }
+        return p;
+    }
+};
@@ -27,9 +27,134 @@
 #include <cstdint>
 #include <cstdlib>
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
-using Int = std::int32_t;
+#if defined( _MSC_VER ) and ( defined( _M_X64 ) or defined( _M_IX86 ) )
+#    include <xmmintrin.h>
+#endif
+
+using Int = std::int32_t; // The default id type of the flat trees, see checked_id.
+
+// Befriended by the trees, gives (tree-generic) tools access to the flat vectors.
+class tree_access;
+
+// The order in which the node-only trees (fsnt, fsntu) copy the nodes on a re-root. Breadth first, the children of
+// a node are contiguous, i.e. child i of a node is at the index of the first child plus i.
+enum class Layout : int { depth_first, breadth_first };
+
+// The in-arc bookkeeping of fst: graph keeps the list of in-arcs of every node, tree (the tree is known to be a tree,
+// f.e. a search without transpositions) keeps just the parent arc of every node, the arcs and nodes are smaller and
+// addArc writes half as much.
+enum class Links : int { graph, tree };
+
+// The id (ArcID or NodeID) of the element at index_ of a flat tree vector. The id type is a template parameter of the
+// trees (Int by default), a tree outgrowing it throws, instead of wrapping around to the admin elements.
+template<typename ID>
+[[nodiscard]] ID checked_id ( std::size_t const index_ ) {
+    using value_type = typename ID::value_type;
+    static_assert ( std::is_integral<value_type>::value, "the id type of a tree is an integral type" );
+    if ( index_ > static_cast<std::size_t> ( std::numeric_limits<value_type>::max ( ) ) )
+        throw std::length_error ( "the tree outgrew its id type" );
+    return ID{ index_ };
+}
+
+// Make room for n_ more elements in vector_, keeping the growth geometric (a reserve of exactly size ( ) + n_ would make
+// a sequence of bulk appends quadratic).
+template<typename Vector>
+void reserve_more ( Vector & vector_, std::size_t const n_ ) {
+    if ( vector_.size ( ) + n_ > vector_.capacity ( ) )
+        vector_.reserve ( std::max ( vector_.size ( ) + n_, 2 * vector_.capacity ( ) ) );
+}
+
+// Hint the hardware to fetch the cache line of address_, ahead of its use (f.e. the next node of a walk, while the
+// current one is being worked on). A hint only, address_ is not dereferenced.
+inline void prefetch ( void const * const address_ ) noexcept {
+#if defined( _MSC_VER ) and ( defined( _M_X64 ) or defined( _M_IX86 ) )
+    _mm_prefetch ( static_cast<char const *> ( address_ ), _MM_HINT_T0 );
+#elif defined( __GNUC__ ) or defined( __clang__ )
+    __builtin_prefetch ( address_ );
+#else
+    ( void ) address_;
+#endif
+}
+
+// The step of the backups of the trees: apply update_ ( data_, value_ ), if update_ returns a value, that value replaces
+// value_, i.e. it is what the next node up gets (f.e. the negation, negamax).
+template<typename Update, typename Data, typename Value>
+void apply_update ( Update & update_, Data & data_, Value & value_ ) {
+    if constexpr ( std::is_void<std::invoke_result_t<Update &, Data &, Value const &>>::value )
+        update_ ( data_, static_cast<Value const &> ( value_ ) );
+    else
+        value_ = update_ ( data_, static_cast<Value const &> ( value_ ) );
+}
+
+// Visited marks (by index) that are all reset in O ( 1 ): a mark is the number of the walk that set it, next starts a
+// new walk and so invalidates the marks of the previous ones. The marks are only cleared when the walk number wraps.
+class EpochMarks {
+
+    std::vector<std::uint32_t> m_marks;
+    std::uint32_t m_walk = 0;
+
+    public:
+    // Start a new walk over (at least) size_ elements.
+    void next ( std::size_t const size_ ) {
+        if ( size_ > m_marks.size ( ) )
+            m_marks.resize ( std::max ( size_, 2 * m_marks.size ( ) ), 0u );
+        if ( not ++m_walk ) { // Wrapped, start over.
+            std::fill ( std::begin ( m_marks ), std::end ( m_marks ), 0u );
+            m_walk = 1;
+        }
+    }
+
+    [[nodiscard]] bool is_marked ( std::size_t const index_ ) const noexcept { return m_walk == m_marks[ index_ ]; }
+
+    // Returns false if index_ was marked (in this walk) already.
+    [[maybe_unused]] bool mark ( std::size_t const index_ ) noexcept {
+        if ( m_walk == m_marks[ index_ ] )
+            return false;
+        m_marks[ index_ ] = m_walk;
+        return true;
+    }
+
+    [[nodiscard]] std::size_t size ( ) const noexcept { return m_marks.size ( ); }
+};
+
+// The generation of a tree, a process-wide unique number that changes whenever the ids of the tree go stale: a re-root
+// or a prune (bump), an assignment or a copy (a copy gets a new number, a move takes the number along and bumps the
+// moved-from tree). Side structures keyed by ids (f.e. a ckpt::CheckpointWriter) compare it to the number they saw last.
+class Generation {
+
+    std::uint64_t m_value = next ( );
+
+    [[nodiscard]] static std::uint64_t next ( ) noexcept {
+        static std::atomic<std::uint64_t> counter{ 0u };
+        return counter.fetch_add ( 1u, std::memory_order_relaxed ) + 1u;
+    }
+
+    public:
+    Generation ( ) noexcept {}
+    Generation ( Generation const & ) noexcept {}
+    Generation ( Generation && other_ ) noexcept : m_value{ other_.m_value } { other_.bump ( ); }
+
+    [[maybe_unused]] Generation & operator= ( Generation const & ) noexcept {
+        bump ( );
+        return *this;
+    }
+    [[maybe_unused]] Generation & operator= ( Generation && other_ ) noexcept {
+        m_value = other_.m_value;
+        other_.bump ( );
+        return *this;
+    }
+
+    void bump ( ) noexcept { m_value = next ( ); }
+
+    [[nodiscard]] std::uint64_t value ( ) const noexcept { return m_value; }
+};
 
 struct std_tag {};
 
@@ -0,0 +1,163 @@
+
+// MIT License
+//
+// Copyright (c) 2018, 2019, 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+#include "tree_access.hpp"
+
+// Progressive widening on the flat trees (fst, fsth, fsnt, fsntu). A node may select among ceil ( k * visits ^ alpha ) of its
+// children (at least one), the active children, in the order of expansion. Adding the children one at a time, as the
+// node widens, spreads the siblings over the tree, as the tree grows in between. Instead, the children are expanded
+// in slabs, with addChildren (add_children): a node that runs out of children gets as many new ones as it has (its
+// capacity doubles), contiguously, and the widening activates them one by one. A node with n children has them in
+// log2 ( n ) contiguous runs, at the cost of at most as many (inactive) children as active ones.
+
+namespace pw {
+
+// The widening schedule, k * visits ^ alpha children.
+struct Schedule {
+    double k = 1.0, alpha = 0.5;
+
+    [[nodiscard]] std::size_t allowed ( std::uint32_t const visits_ ) const noexcept {
+        return std::max ( std::size_t{ 1 }, static_cast<std::size_t> ( std::ceil ( k * std::pow ( double ( visits_ ), alpha ) ) ) );
+    }
+};
+
+template<typename Tree>
+class Widener {
+
+    template<typename Node, typename = void>
+    struct has_next : std::false_type {};
+    template<typename Node>
+    struct has_next<Node, std::void_t<decltype ( std::declval<Node const &> ( ).next )>> : std::true_type {};
+
+    public:
+    using NodeID = typename Tree::NodeID;
+
+    static constexpr std::uint32_t table_size = 1u << 16; // The schedule is tabled up to this number of visits.
+
+    explicit Widener ( Schedule const & schedule_ = Schedule{ } ) : m_schedule{ schedule_ } {}
+
+    [[nodiscard]] Schedule const & schedule ( ) const noexcept { return m_schedule; }
+
+    // The number of children of node_ that may be selected, the first ones expanded.
+    [[nodiscard]] std::size_t active ( NodeID const node_ ) const noexcept {
+        return static_cast<std::size_t> ( node_.value ) < m_active.size ( ) ? m_active[ node_.value ] : 0u;
+    }
+
+    // The number of children of node_, active or not.
+    [[nodiscard]] static std::size_t children ( Tree const & tree_, NodeID const node_ ) noexcept {
+        if constexpr ( tree_access::has_arcs<Tree> )
+            return static_cast<std::size_t> ( tree_.outArcNum ( node_ ) );
+        else
+            return static_cast<std::size_t> ( tree_.arity ( node_ ) );
+    }
+
+    // Widen node_ to the number of children the schedule allows after visits_ visits, of which at most remaining_ are
+    // not expanded yet (f.e. the moves left). A node that runs out of children gets a slab of as many new children as
+    // it has, but at least the number needed, at most remaining_, with addChildren ( node_, slab, generator_ ), see
+    // there. Returns the number of active children.
+    template<typename Generator>
+    std::size_t widen ( Tree & tree_, NodeID const node_, std::uint32_t const visits_, std::size_t const remaining_,
+                        Generator && generator_ ) {
+        if ( static_cast<std::size_t> ( node_.value ) >= m_active.size ( ) )
+            m_active.resize ( 2 * static_cast<std::size_t> ( node_.value ) + 1, 0u );
+        std::size_t const have = children ( tree_, node_ ), target = std::min ( allowed ( visits_ ), have + remaining_ );
+        if ( target > have ) {
+            std::size_t const slab = std::min ( std::max ( have, target - have ), remaining_ );
+            if constexpr ( tree_access::has_arcs<Tree> )
+                tree_.addChildren ( node_, slab, std::forward<Generator> ( generator_ ) );
+            else
+                tree_.add_children ( node_, slab, std::forward<Generator> ( generator_ ) );
+        }
+        std::uint32_t & active = m_active[ node_.value ];
+        active                 = static_cast<std::uint32_t> ( std::max<std::size_t> ( active, target ) );
+        return active;
+    }
+
+    // Call function_ ( NodeID ) for the active children of node_, in the order of the out-list (fsntu lists the
+    // children newest first, the inactive ones are skipped).
+    template<typename Function>
+    void forEachActive ( Tree const & tree_, NodeID const node_, Function && function_ ) const {
+        std::size_t n = active ( node_ );
+        if constexpr ( tree_access::has_arcs<Tree> ) {
+            for ( auto it = tree_.cbeginOut ( node_ ); n and it.is_valid ( ); ++it, --n )
+                function_ ( it->target );
+        }
+        else if constexpr ( has_next<typename Tree::Node>::value ) { // fsnt.
+            for ( typename Tree::const_out_iterator it{ tree_, node_ }; n and it.is_valid ( ); ++it, --n )
+                function_ ( it.id ( ) );
+        }
+        else { // fsntu.
+            typename Tree::const_out_iterator it{ tree_, node_ };
+            for ( std::size_t skip = children ( tree_, node_ ) - n; skip; --skip )
+                ++it;
+            for ( ; it.is_valid ( ); ++it )
+                function_ ( it.id ( ) );
+        }
+    }
+
+    void clear ( ) noexcept { m_active.clear ( ); }
+
+    // After a prune (gc::prune) of tree_, move the active counts to the new ids, remap_ is the new id by old id (invalid
+    // if pruned), as prune returns it. A node that lost children keeps at most as many active ones as it has left.
+    void remap ( Tree const & tree_, std::vector<NodeID> const & remap_ ) {
+        std::size_t size = 0;
+        for ( std::size_t n = 1; n < remap_.size ( ) and n < m_active.size ( ); ++n )
+            if ( NodeID::invalid ( ) != remap_[ n ] ) {
+                assert ( static_cast<std::size_t> ( remap_[ n ].value ) <= n );
+                m_active[ remap_[ n ].value ] = static_cast<std::uint32_t> (
+                    std::min<std::size_t> ( m_active[ n ], children ( tree_, remap_[ n ] ) ) );
+                size = static_cast<std::size_t> ( remap_[ n ].value ) + 1;
+            }
+        m_active.resize ( std::min ( size, m_active.size ( ) ) );
+    }
+
+    private:
+    [[nodiscard]] std::size_t allowed ( std::uint32_t const visits_ ) {
+        if ( visits_ >= table_size )
+            return m_schedule.allowed ( visits_ );
+        while ( m_table.size ( ) <= visits_ )
+            m_table.push_back (
+                static_cast<std::uint32_t> ( m_schedule.allowed ( static_cast<std::uint32_t> ( m_table.size ( ) ) ) ) );
+        return m_table[ visits_ ];
+    }
+
+    Schedule m_schedule;
+    std::vector<std::uint32_t> m_active; // By node.
+    std::vector<std::uint32_t> m_table;  // The schedule by visits.
+};
+
+} // namespace pw